@@ -0,0 +1,57 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+ #include <iostream>
+#include <sys/resource.h>
+
+#include "../model/io_cost.hpp"
+
+// replays 10^8 writes through the fast syscall model, the resident set size must stay flat
+int main () {
+
+    long writes = 100l * 1000l * 1000l;
+    long report_step = writes / 10;
+    long chunk_size = 256l * 1024l;
+    double interval = 0.0001;
+
+    std::string path = "path_to_dev";
+    measurement::system_env sys (path);
+    model::io_cost iocost (sys);
+
+    std::cout << sys << std::endl;
+
+    auto max_rss_kb = [] () {
+        rusage usage {};
+        getrusage (RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    };
+
+    measurement::timer_pack timer;
+    double model_cost {};
+
+    timer.start (0);
+    for (long i = 1; i <= writes; ++i) {
+        model_cost += iocost.syscall_io_cost (chunk_size, interval);
+        if (i % report_step == 0) {
+            std::cout << "writes " << i
+                      << ", model cost " << model_cost
+                      << ", dirty " << iocost.dirty
+                      << ", max rss kB " << max_rss_kb ()
+                      << ", elapsed " << timer.live_duration (0) << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -72,6 +72,8 @@ public:
                 return std::make_unique <T>(value);
             }
         }
+        // a missing property must not fail the lookups of the others
+        conf.clear ();
         return nullptr;
     }
 
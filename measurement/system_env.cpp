@@ -18,6 +18,12 @@
 //
 
 #include <climits>
+#include <limits>
+#include <cmath>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
 #include "system_env.hpp"
 #include "utils.hpp"
 
@@ -99,6 +105,41 @@ double measurement::system_env::measure_seek_syscall_cost () const {
     return cost;
 }
 
+/**
+ * Overhead of every additional buffer of a writev call, measured as the difference between gathering small
+ * chunks with writev and writing the same data from one buffer.
+ */
+double measurement::system_env::measure_iovec_cost () const {
+    const long data_size = iovec_measure_count * iovec_measure_chunk_size;
+    std::vector <std::byte> buf (data_size);
+    std::vector <iovec> iov (iovec_measure_count);
+    for (int i = 0; i < iovec_measure_count; ++i) {
+        iov [i] = {buf.data () + i * iovec_measure_chunk_size, iovec_measure_chunk_size};
+    }
+    const long repeats = syscall_measure_repeats / iovec_measure_count;
+
+    blocking_sync ();
+    int fd = open (dummyfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRWXU);
+    assert (write (fd, buf.data (), data_size) == data_size);
+
+    timer_pack <2> timers;
+    timers.start (0);
+    for (long i = 0; i < repeats; ++i) {
+        assert (pwrite (fd, buf.data (), data_size, 0) == data_size);
+    }
+    timers.stop (0);
+
+    timers.start (1);
+    for (long i = 0; i < repeats; ++i) {
+        assert (pwritev (fd, iov.data (), iovec_measure_count, 0) == data_size);
+    }
+    timers.stop (1);
+    close (fd);
+
+    const double per_call = (timers.duration (1) - timers.duration (0)) / static_cast <double> (repeats);
+    return std::max (0.0, per_call / (iovec_measure_count - 1));
+}
+
 long measurement::system_env::fetch_logical_block_size () {
     long logical_block_size;
     std::ifstream ifs ("/sys/block/sda/queue/logical_block_size");
@@ -123,9 +164,9 @@ std::string measurement::system_env::get_hostname () {
  * @param min_size
  * @param max_size
  * @param step
- * @return  <write syscall cost, write bw, read syscall cost, read bw>
+ * @return  <write syscall cost, write bw, read syscall cost, read bw, relative residual of the writes and reads>
  */
-std::tuple <double, double, double, double>
+std::tuple <double, double, double, double, double, double>
 measurement::system_env::perform_regression_experiment (long min_size, long max_size, long step, long repeats) const {
 
     timer_pack <2> timers;
@@ -218,7 +259,8 @@ lseek (fd, 0, SEEK_SET);
     munmap (buf, max_size);
     close (fd);
 
-    return {write_regr.first, 1.0 / write_regr.second, read_regr.first, 1.0 / read_regr.second};
+    return {write_regr.first, 1.0 / write_regr.second, read_regr.first, 1.0 / read_regr.second,
+            utils::relative_residual (x, expr_values, write_regr), utils::relative_residual (x, read_expr_values, read_regr)};
 }
 
 
@@ -249,10 +291,193 @@ std::pair <double, double> measurement::system_env::measure_device_bandwidth ()
 
     auto wbw = std::get <1> (normal_performance);
     auto rbw = std::get <3> (normal_performance);
+    spread.bw_dev = std::get <4> (normal_performance);
+    spread.bw_rdev = std::get <5> (normal_performance);
 
     return {rbw, wbw};
 }
 
+/**
+ * Latency of fsync or fdatasync beyond the transfer of the dirty data, i.e. the device cache flush and, for
+ * fsync, the journal commit of the metadata. A single page of the file is overwritten before every call.
+ *
+ * @param data_only     measure fdatasync instead of fsync
+ */
+double measurement::system_env::measure_sync_latency (bool data_only) {
+    assert (pagesize > 0 && bw_dev > 0);
+
+    blocking_sync ();
+    std::vector <std::byte> buf (pagesize);
+    int fd = open (dummyfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRWXU);
+    assert (write (fd, buf.data (), pagesize) == pagesize);
+    fsync (fd);
+
+    timer_pack <1> timers;
+    for (int i = 0; i < sync_latency_measure_repeats; ++i) {
+        assert (pwrite (fd, buf.data (), pagesize, 0) == pagesize);
+        timers.start (0);
+        if (data_only) {
+            fdatasync (fd);
+        }
+        else {
+            fsync (fd);
+        }
+        timers.stop (0);
+    }
+    close (fd);
+
+    const double latency = std::max (0.0, timers.avg_duration (0) - static_cast <double> (pagesize) / bw_dev);
+    (data_only ? spread.sc_fdatasync : spread.sc_fsync) = latency > 0.0 ? timers.stddev_duration (0) / latency : 0.0;
+    return latency;
+}
+
+/**
+ * Positioning latency of the device: the extra time of direct writes of single pages at random offsets over
+ * the time of the same writes in sequence. The bandwidth of writing extents of size s that do not continue
+ * each other follows as s / (wb_pos + s / bw_dev).
+ */
+double measurement::system_env::measure_positioning_latency () const {
+    assert (pagesize > 0);
+
+    const long pages = positioning_measure_span / pagesize;
+    std::vector <long> offsets (positioning_measure_writes);
+    std::default_random_engine engine (random_seek);
+    std::uniform_int_distribution <long> page (0, pages - 1);
+    for (auto &offset: offsets) {
+        offset = page (engine) * pagesize;
+    }
+
+    auto buf = (unsigned char *) mmap (nullptr, pagesize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    blocking_sync ();
+#ifdef _GNU_SOURCE
+    int fd = open (dummyfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DSYNC | O_DIRECT, S_IRWXU);
+#else
+    int fd = open (dummyfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DSYNC, S_IRWXU);
+#endif
+    if (ftruncate (fd, positioning_measure_span) != 0) {
+        perror ("Could not size the positioning measurement file");
+        close (fd);
+        munmap (buf, pagesize);
+        return 0.0;
+    }
+
+    timer_pack <2> timers;
+    timers.start (0);
+    for (int i = 0; i < positioning_measure_writes; ++i) {
+        assert (pwrite (fd, buf, pagesize, i * pagesize) == pagesize);
+    }
+    timers.stop (0);
+
+    timers.start (1);
+    for (const auto offset: offsets) {
+        assert (pwrite (fd, buf, pagesize, offset) == pagesize);
+    }
+    timers.stop (1);
+
+    close (fd);
+    munmap (buf, pagesize);
+
+    const double per_write = (timers.duration (1) - timers.duration (0)) / positioning_measure_writes;
+    return std::max (0.0, per_write);
+}
+
+/**
+ * Write cache of the device, e.g. the SLC cache of consumer and QLC SSDs. Large chunks are written with
+ * O_DIRECT and O_DSYNC until the bandwidth drops below a fraction of the bandwidth of the first chunk; the
+ * bytes written until then are the size of the cache and the bandwidth of some more chunks is the sustained
+ * one. After an idle period the writes are repeated, the bytes written until the drop then were freed while
+ * idle. The chunks cycle through a span of the file, as the cache fills with every write to the device.
+ *
+ * @return      the cache size, the sustained bandwidth and the recovery rate, or 0, bw_dev and 0 without a drop
+ */
+std::tuple <long, double, double> measurement::system_env::measure_write_cache () const {
+    assert (bw_dev > 0);
+
+    auto buf = (unsigned char *) mmap (nullptr, write_cache_measure_chunk_size, PROT_READ|PROT_WRITE,
+                                       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    std::memset (buf, 1, write_cache_measure_chunk_size);
+    blocking_sync ();
+#ifdef _GNU_SOURCE
+    int fd = open (dummyfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DSYNC | O_DIRECT, S_IRWXU);
+#else
+    int fd = open (dummyfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DSYNC, S_IRWXU);
+#endif
+
+    long offset {};
+    auto write_chunk = [fd, buf, &offset] () {
+        timer_pack <1> timers;
+        timers.start (0);
+        assert (pwrite (fd, buf, write_cache_measure_chunk_size, offset) == write_cache_measure_chunk_size);
+        timers.stop (0);
+        offset = (offset + write_cache_measure_chunk_size) % write_cache_measure_span;
+        return static_cast <double> (write_cache_measure_chunk_size) / timers.duration (0);
+    };
+
+    // bytes written before the bandwidth drops below the given fraction of the first chunk, -1 without a drop
+    auto write_until_drop = [&write_chunk] () {
+        const double full = write_chunk ();
+        for (long chunk = 1; chunk < write_cache_measure_max_chunks; ++chunk) {
+            if (write_chunk () < write_cache_measure_drop * full) {
+                return chunk * write_cache_measure_chunk_size;
+            }
+        }
+        return -1l;
+    };
+
+    std::tuple <long, double, double> cache {0, bw_dev, 0.0};
+    const long size = write_until_drop ();
+    if (size > 0) {
+        double sustained {};
+        for (long chunk = 0; chunk < write_cache_measure_sustained_chunks; ++chunk) {
+            sustained += write_chunk ();
+        }
+        sleep (write_cache_measure_idle_seconds);
+        const long recovered = std::max (0l, write_until_drop ());
+        cache = {size, sustained / write_cache_measure_sustained_chunks,
+                 static_cast <double> (recovered) / write_cache_measure_idle_seconds};
+    }
+
+    close (fd);
+    munmap (buf, write_cache_measure_chunk_size);
+    return cache;
+}
+
+/**
+ * Cost of a write fault on a shared file mapping, i.e. the first store to a page that is not dirty. The store
+ * itself writes a single byte and is negligible.
+ */
+double measurement::system_env::measure_page_fault_cost () const {
+    assert (pagesize > 0);
+
+    const long size = page_fault_measure_pages * pagesize;
+    blocking_sync ();
+    int fd = open (dummyfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRWXU);
+    // stores beyond the end of the file would raise SIGBUS
+    if (ftruncate (fd, size) != 0) {
+        perror ("Could not size the page fault measurement file");
+        close (fd);
+        return 0.0;
+    }
+    auto map = (unsigned char *) mmap (nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror ("Could not map the page fault measurement file");
+        close (fd);
+        return 0.0;
+    }
+
+    timer_pack <1> timers;
+    timers.start (0);
+    for (long i = 0; i < page_fault_measure_pages; ++i) {
+        map [i * pagesize] = 1;
+    }
+    timers.stop (0);
+
+    munmap (map, size);
+    close (fd);
+
+    return timers.duration (0) / static_cast <double> (page_fault_measure_pages);
+}
+
 std::pair <long, long> measurement::system_env::fetch_dirty_limits () {
     long pagesize = getpagesize ();
 
@@ -285,6 +510,150 @@ int measurement::system_env::fetch_dirty_expire_centisecs () {
     return dirty_expire_centisecs / 100;
 }
 
+void measurement::system_env::fetch_dirty_settings () {
+    auto fetch = [] (const std::string &name, auto &value) {
+        std::ifstream ifs ("/proc/sys/vm/" + name);
+        ifs >> value;
+    };
+    fetch ("dirty_ratio", dirty_ratio);
+    fetch ("dirty_background_ratio", dirty_background_ratio);
+    fetch ("dirty_bytes", dirty_bytes);
+    fetch ("dirty_background_bytes", dirty_background_bytes);
+}
+
+long measurement::system_env::fetch_dirtyable_memory () {
+    monitor::meminfo_monitor mm;
+    const long pages = mm.get_property ("MemFree") + mm.get_property ("Active(file)") +
+                       mm.get_property ("Inactive(file)");
+    return std::max (0l, pages) * 1024l;
+}
+
+long measurement::system_env::fetch_nr_dirtied () {
+    long nr_dirtied = 0;
+    std::ifstream ifs ("/proc/vmstat");
+    std::string word;
+    while (ifs >> word) {
+        if (word == "nr_dirtied") {
+            ifs >> nr_dirtied;
+            break;
+        }
+    }
+    return nr_dirtied * fetch_pagesize ();
+}
+
+std::pair <long, long> measurement::system_env::dirty_limits (long dirtyable_memory) const {
+    // as domain_dirty_limits in mm/page-writeback.c, without the boost of real-time tasks
+    long hard = dirty_bytes > 0 ? dirty_bytes : dirtyable_memory / 100 * dirty_ratio;
+    long bg = dirty_background_bytes > 0 ? dirty_background_bytes : dirtyable_memory / 100 * dirty_background_ratio;
+    if (bg >= hard) {
+        bg = hard / 2;
+    }
+    return {bg, hard};
+}
+
+std::pair <long, long> measurement::system_env::memcg_dirty_limits (long dirtyable_memory) const {
+    assert (memcg);
+    const long headroom = std::max (0l, memcg->limit () - memcg->current);
+    const long available = memcg->file + std::min (headroom, dirtyable_memory);
+    auto limits = dirty_limits (available);
+    if (dirtyable_memory > 0) {
+        const double share = static_cast <double> (available) / static_cast <double> (dirtyable_memory);
+        if (dirty_bytes > 0) {
+            limits.second = static_cast <long> (static_cast <double> (dirty_bytes) * share);
+        }
+        if (dirty_background_bytes > 0) {
+            limits.first = static_cast <long> (static_cast <double> (dirty_background_bytes) * share);
+        }
+        if (limits.first >= limits.second) {
+            limits.first = limits.second / 2;
+        }
+    }
+    return limits;
+}
+
+std::optional <measurement::memcg_env> measurement::system_env::fetch_memcg () {
+    // the cgroup v2 entry of the process reads 0::<path>
+    std::ifstream cgroup ("/proc/self/cgroup");
+    std::string line, path;
+    while (std::getline (cgroup, line)) {
+        if (line.starts_with ("0::")) {
+            path = "/sys/fs/cgroup" + line.substr (3);
+        }
+    }
+    if (path.empty ()) {
+        return std::nullopt;
+    }
+
+    auto fetch = [&path] (const std::string &name) {
+        std::ifstream ifs (path + "/" + name);
+        std::string value;
+        if (!(ifs >> value)) {
+            return -1l;
+        }
+        return value == "max" ? std::numeric_limits <long>::max () : std::stol (value);
+    };
+
+    memcg_env env {fetch ("memory.max"), fetch ("memory.high"), fetch ("memory.current"), 0};
+    if (env.max < 0 || env.high < 0 || env.current < 0 || env.limit () == std::numeric_limits <long>::max ()) {
+        // no memory controller or no limit
+        return std::nullopt;
+    }
+
+    std::ifstream stat (path + "/memory.stat");
+    std::string key;
+    long value;
+    while (stat >> key >> value) {
+        if (key == "file") {
+            env.file = value;
+            break;
+        }
+    }
+    return env;
+}
+
+int measurement::system_env::fetch_dirty_writeback_centisecs () {
+    int dirty_writeback_centisecs;
+    std::ifstream ifs ("/proc/sys/vm/dirty_writeback_centisecs");
+    ifs >> dirty_writeback_centisecs;
+    return dirty_writeback_centisecs;
+}
+
+long measurement::system_env::fetch_page_cache_capacity () {
+    // memory the page cache can grow to without swapping, including the reclaimable part of the current cache
+    monitor::meminfo_monitor mm;
+    return std::max (0l, mm.get_property ("MemAvailable")) * 1024l;
+}
+
+/**
+ * max_ratio of the backing device of a path in /sys/class/bdi, 100 if it cannot be read. A partition shares the
+ * bdi of its disk.
+ */
+int measurement::system_env::fetch_bdi_max_ratio (const std::string &path) {
+#ifdef LOCAL_MAC
+    return 100;
+#else
+    struct stat st {};
+    if (stat (path.c_str (), &st) != 0) {
+        return 100;
+    }
+    auto read_ratio = [] (const std::string &bdi) -> std::optional <int> {
+        int ratio;
+        std::ifstream ifs ("/sys/class/bdi/" + bdi + "/max_ratio");
+        return ifs >> ratio ? std::optional {ratio} : std::nullopt;
+    };
+    const auto bdi = std::to_string (major (st.st_dev)) + ":" + std::to_string (minor (st.st_dev));
+    if (const auto ratio = read_ratio (bdi)) {
+        return *ratio;
+    }
+    std::string disk;
+    std::ifstream parent ("/sys/dev/block/" + bdi + "/../dev");
+    if (parent >> disk) {
+        return read_ratio (disk).value_or (100);
+    }
+    return 100;
+#endif
+}
+
 double measurement::system_env::measure_memory_write_bandwidth () {
 
     auto p1 = (unsigned char *) mmap (nullptr, memory_bandwidth_measure_data_size, PROT_READ|PROT_WRITE,
@@ -358,7 +727,7 @@ long measurement::system_env::fetch_clib_buffer_size () const {
     return buffer_size;
 }
 
-std::tuple <double, double, double> measurement::system_env::measure_ramdisk_bandwidths () const {
+std::tuple <double, double, double> measurement::system_env::measure_ramdisk_bandwidths () {
 
     assert (limit_bg > 0 && limit_hard > 0 && sc_w > 0);
 
@@ -430,6 +799,11 @@ std::tuple <double, double, double> measurement::system_env::measure_ramdisk_ban
     double async_bw = static_cast <double> (ramdisk_bandwidth_measure_data_size) / (timer.avg_duration (1) - sc_w);
     double sync_bw = static_cast <double> (ramdisk_bandwidth_measure_data_size) / (timer.avg_duration (2) - sc_w);
 
+    // the relative spread of the bandwidths follows that of the write durations
+    spread.bw_ramdisk = timer.stddev_duration (0) / timer.avg_duration (0);
+    spread.bw_async = timer.stddev_duration (1) / timer.avg_duration (1);
+    spread.bw_sync = timer.stddev_duration (2) / timer.avg_duration (2);
+
     std::tuple bandwidths = {freerun_bw, async_bw, sync_bw};
     return bandwidths;
 }
@@ -448,8 +822,12 @@ void measurement::system_env::measure_host () {
     std::cout << "measured write syscall cost" << std::endl;
     sc_sk = measure_seek_syscall_cost ();
     std::cout << "measured seek system call cost" << std::endl;
+    sc_iov = measure_iovec_cost ();
+    std::cout << "measured writev buffer cost" << std::endl;
     dirty_expire = fetch_dirty_expire_centisecs ();
     std::cout << "fetched dirty expire" << std::endl;
+    dirty_writeback = fetch_dirty_writeback_centisecs () / 100.0;
+    std::cout << "fetched dirty writeback interval" << std::endl;
     bw_mem = measure_memory_write_bandwidth ();
     std::cout << "measured memory write bandwidth" << std::endl;
     bf = fetch_clib_buffer_size ();
@@ -461,6 +839,22 @@ void measurement::system_env::measure_host () {
     bw_rdev = rbw;
     bw_dev = wbw;
     std::cout << "measured device bandwidths" << std::endl;
+    sc_fsync = measure_sync_latency (false);
+    sc_fdatasync = measure_sync_latency (true);
+    std::cout << "measured fsync and fdatasync latencies" << std::endl;
+    wb_pos = measure_positioning_latency ();
+    std::cout << "measured writeback positioning latency" << std::endl;
+    if (calibrate_write_cache) {
+        std::tie (wcache_size, bw_dev_sustained, wcache_recovery) = measure_write_cache ();
+        std::cout << "measured device write cache" << std::endl;
+    }
+    else {
+        wcache_size = 0;
+        bw_dev_sustained = bw_dev;
+        wcache_recovery = 0.0;
+    }
+    sc_pf = measure_page_fault_cost ();
+    std::cout << "measured page fault cost" << std::endl;
     const auto &[freerun, asnyc, sync] = measure_ramdisk_bandwidths ();
     bw_ramdisk = freerun;
     coeff_bg = asnyc / freerun;
@@ -470,7 +864,33 @@ void measurement::system_env::measure_host () {
     remove (dummyfile.c_str());
 }
 
+measurement::system_env measurement::system_env::sample (std::mt19937_64 &engine) const {
+    // mean preserving log-normal factor, it keeps the parameters positive
+    auto factor = [&engine] (double rsd) {
+        if (rsd <= 0.0) {
+            return 1.0;
+        }
+        const double sigma = std::sqrt (std::log1p (rsd * rsd));
+        std::normal_distribution <double> normal (-sigma * sigma / 2, sigma);
+        return std::exp (normal (engine));
+    };
+
+    system_env env {*this};
+    env.bw_dev *= factor (spread.bw_dev);
+    env.bw_rdev *= factor (spread.bw_rdev);
+    env.sc_fsync *= factor (spread.sc_fsync);
+    env.sc_fdatasync *= factor (spread.sc_fdatasync);
+    const double freerun = factor (spread.bw_ramdisk);
+    env.bw_ramdisk *= freerun;
+    env.coeff_bg = std::min (1.0, coeff_bg * factor (spread.bw_async) / freerun);
+    env.bw_sync *= factor (spread.bw_sync);
+    // the drop beyond the device cache keeps its ratio to the full bandwidth
+    env.bw_dev_sustained *= env.bw_dev / bw_dev;
+    return env;
+}
+
 bool measurement::system_env::load_from_config () {
+    config conf {config_file};
     std::string section = get_config_section ();
     bool success = conf.go_to_section (section);
     if (!success) {
@@ -492,37 +912,84 @@ bool measurement::system_env::load_from_config () {
     get_val_from_ptr (sc_sw, conf.get_property <double> ("sync_write_syscall_cost"));
     get_val_from_ptr (pagesize, conf.get_property <double> ("page_size"));
     get_val_from_ptr (sc_sk, conf.get_property <double> ("seek_syscall_cost"));
+    get_val_from_ptr (sc_iov, conf.get_property <double> ("writev_buffer_cost"));
+    get_val_from_ptr (sc_fsync, conf.get_property <double> ("fsync_latency"));
+    get_val_from_ptr (sc_fdatasync, conf.get_property <double> ("fdatasync_latency"));
+    get_val_from_ptr (sc_pf, conf.get_property <double> ("page_fault_cost"));
     get_val_from_ptr (bs, conf.get_property <long> ("logical_block_size"));
     get_val_from_ptr (bw_rdev, conf.get_property <double> ("device_read_bandwidth"));
     get_val_from_ptr (bw_dev, conf.get_property <double> ("device_write_bandwidth"));
+    get_val_from_ptr (wb_pos, conf.get_property <double> ("writeback_positioning_latency"));
+    // without the write cache parameters the device has none, unless their calibration is asked for
+    if (const auto calibrate = conf.get_property <int> ("device_write_cache_calibration")) {
+        calibrate_write_cache = *calibrate != 0;
+    }
+    bw_dev_sustained = bw_dev;
+    auto get_wcache_val_from_ptr = [this, &config_load] (auto &val, const auto &ptr) {
+        if (ptr) {
+            val = *ptr;
+        }
+        else if (calibrate_write_cache) {
+            config_load = false;
+        }
+    };
+    get_wcache_val_from_ptr (wcache_size, conf.get_property <long> ("device_write_cache_size"));
+    get_wcache_val_from_ptr (bw_dev_sustained, conf.get_property <double> ("device_sustained_write_bandwidth"));
+    get_wcache_val_from_ptr (wcache_recovery, conf.get_property <double> ("device_write_cache_recovery"));
     get_val_from_ptr (bw_sync, conf.get_property <double> ("OS_sync_bandwidth"));
     get_val_from_ptr (bw_ramdisk, conf.get_property <double> ("ramdisk_write_bandwidth"));
     get_val_from_ptr (dirty_expire, conf.get_property <int> ("dirty_expire_seconds"));
+    get_val_from_ptr (dirty_writeback, conf.get_property <double> ("dirty_writeback_seconds"));
     get_val_from_ptr (coeff_bg, conf.get_property <double> ("OS_background_sync_coefficient"));
     get_val_from_ptr (bw_mem, conf.get_property <double> ("memory_write_bandwidth"));
     get_val_from_ptr (bf, conf.get_property <long> ("C_library_buffer_size"));
     get_val_from_ptr (lib_metacost, conf.get_property <double> ("C_library_latency"));
+    get_val_from_ptr (spread.bw_dev, conf.get_property <double> ("device_write_bandwidth_rsd"));
+    get_val_from_ptr (spread.bw_rdev, conf.get_property <double> ("device_read_bandwidth_rsd"));
+    get_val_from_ptr (spread.sc_fsync, conf.get_property <double> ("fsync_latency_rsd"));
+    get_val_from_ptr (spread.sc_fdatasync, conf.get_property <double> ("fdatasync_latency_rsd"));
+    get_val_from_ptr (spread.bw_ramdisk, conf.get_property <double> ("ramdisk_write_bandwidth_rsd"));
+    get_val_from_ptr (spread.bw_async, conf.get_property <double> ("ramdisk_background_bandwidth_rsd"));
+    get_val_from_ptr (spread.bw_sync, conf.get_property <double> ("OS_sync_bandwidth_rsd"));
 
     return config_load;
 }
 
 void measurement::system_env::store_to_config () {
 
+    config conf {config_file};
     conf.add_section (get_config_section());
     conf.add_property ("write_syscall_cost", sc_w);
     conf.add_property ("page_size", pagesize);
     conf.add_property ("sync_write_syscall_cost", sc_sw);
     conf.add_property ("seek_syscall_cost", sc_sk);
+    conf.add_property ("writev_buffer_cost", sc_iov);
+    conf.add_property ("fsync_latency", sc_fsync);
+    conf.add_property ("fdatasync_latency", sc_fdatasync);
+    conf.add_property ("page_fault_cost", sc_pf);
     conf.add_property ("logical_block_size", bs);
     conf.add_property ("device_read_bandwidth", bw_rdev);
     conf.add_property ("device_write_bandwidth", bw_dev);
+    conf.add_property ("writeback_positioning_latency", wb_pos);
+    conf.add_property ("device_write_cache_size", wcache_size);
+    conf.add_property ("device_sustained_write_bandwidth", bw_dev_sustained);
+    conf.add_property ("device_write_cache_recovery", wcache_recovery);
+    conf.add_property ("device_write_cache_calibration", calibrate_write_cache ? 1 : 0);
     conf.add_property ("OS_sync_bandwidth", bw_sync);
     conf.add_property ("ramdisk_write_bandwidth", bw_ramdisk);
     conf.add_property ("dirty_expire_seconds", dirty_expire);
+    conf.add_property ("dirty_writeback_seconds", dirty_writeback);
     conf.add_property ("OS_background_sync_coefficient", coeff_bg);
     conf.add_property ("memory_write_bandwidth", bw_mem);
     conf.add_property ("C_library_buffer_size", bf);
     conf.add_property ("C_library_latency", lib_metacost);
+    conf.add_property ("device_write_bandwidth_rsd", spread.bw_dev);
+    conf.add_property ("device_read_bandwidth_rsd", spread.bw_rdev);
+    conf.add_property ("fsync_latency_rsd", spread.sc_fsync);
+    conf.add_property ("fdatasync_latency_rsd", spread.sc_fdatasync);
+    conf.add_property ("ramdisk_write_bandwidth_rsd", spread.bw_ramdisk);
+    conf.add_property ("ramdisk_background_bandwidth_rsd", spread.bw_async);
+    conf.add_property ("OS_sync_bandwidth_rsd", spread.bw_sync);
 
     conf.flush();
 
@@ -29,6 +29,7 @@
 #include <memory>
 #include <utility>
 #include <unordered_map>
+#include <optional>
 
 #include <cassert>
 #include <sys/fcntl.h>
@@ -43,6 +44,7 @@
 
 #include <thread>
 #include <sys/mman.h>
+#include <sys/uio.h>
 
 #include "timer_pack.hpp"
 #include "../monitor/meminfo_monitor.hpp"
@@ -53,6 +55,34 @@
 
 namespace measurement {
 
+    // memory accounting of the cgroup v2 the process runs in, in bytes
+    struct memcg_env {
+        long max;
+        long high;
+        long current;
+        // page cache charged to the cgroup
+        long file;
+
+        [[nodiscard]] inline long limit () const noexcept {
+            return std::min (max, high);
+        }
+    };
+
+    /**
+     * Relative standard deviations of the calibrated parameters, i.e. how much the single measurements they
+     * were derived from scattered. 0 marks a parameter as exact.
+     */
+    struct parameter_spread {
+        double bw_dev {};
+        double bw_rdev {};
+        double sc_fsync {};
+        double sc_fdatasync {};
+        double bw_ramdisk {};
+        // the bandwidth of a writer while the flusher runs, bw_ramdisk * coeff_bg
+        double bw_async {};
+        double bw_sync {};
+    };
+
     class system_env {
 
     private:
@@ -64,16 +94,28 @@ namespace measurement {
         static constexpr long device_bandwidth_measure_chunk_number = 10;
         static constexpr long ramdisk_bandwidth_measure_data_size = 512l * 1024l * 1024l;
         static constexpr long memory_bandwidth_measure_data_size = 32 * 1024l;
+        static constexpr int sync_latency_measure_repeats = 64;
+        static constexpr long page_fault_measure_pages = 16384;
+        static constexpr int iovec_measure_count = 1024;
+        static constexpr int positioning_measure_writes = 1024;
+        static constexpr long positioning_measure_span = 1024l * 1024l * 1024l;
+        static constexpr long iovec_measure_chunk_size = 64;
+        static constexpr long write_cache_measure_chunk_size = 256l * 1024l * 1024l;
+        static constexpr long write_cache_measure_span = 1024l * 1024l * 1024l;
+        static constexpr long write_cache_measure_max_chunks = 256;
+        static constexpr long write_cache_measure_sustained_chunks = 8;
+        static constexpr int write_cache_measure_idle_seconds = 60;
+        static constexpr double write_cache_measure_drop = 0.7;
 
         inline static std::string default_config_file = "config.io";
-        config conf;
+        const std::string config_file;
         const std::string device;
         const std::string dummyfile;
 
         template <typename ... T>
         static ssize_t __attribute__ ((noinline)) dummycall (T ... t);
 
-        [[nodiscard]] std::tuple <double, double, double, double>
+        [[nodiscard]] std::tuple <double, double, double, double, double, double>
         perform_regression_experiment (long min_size, long max_size, long step, long repeats) const;
 
         template <typename Callable, typename DummyCallable>
@@ -83,15 +125,35 @@ namespace measurement {
 
         [[nodiscard]] double measure_seek_syscall_cost () const;
 
+        [[nodiscard]] double measure_iovec_cost () const;
+
         [[nodiscard]] double measure_clib_latency () const;
 
         [[nodiscard]] std::pair <double, double> measure_device_bandwidth ();
 
+        [[nodiscard]] double measure_sync_latency (bool data_only);
+
+        [[nodiscard]] double measure_positioning_latency () const;
+
+        [[nodiscard]] std::tuple <long, double, double> measure_write_cache () const;
+
+        [[nodiscard]] double measure_page_fault_cost () const;
+
         [[nodiscard]] static std::pair <long, long> fetch_dirty_limits ();
 
         [[nodiscard]] static int fetch_dirty_expire_centisecs ();
 
-        [[nodiscard]] std::tuple <double, double, double> measure_ramdisk_bandwidths () const;
+        [[nodiscard]] static int fetch_dirty_writeback_centisecs ();
+
+        void fetch_dirty_settings ();
+
+        [[nodiscard]] static std::optional <memcg_env> fetch_memcg ();
+
+        [[nodiscard]] static long fetch_page_cache_capacity ();
+
+        [[nodiscard]] static int fetch_bdi_max_ratio (const std::string &path);
+
+        [[nodiscard]] std::tuple <double, double, double> measure_ramdisk_bandwidths ();
 
         [[nodiscard]] static double measure_memory_write_bandwidth () ;
 
@@ -110,15 +172,42 @@ namespace measurement {
         double sc_w {};
         double sc_sw {};
         double sc_sk {};
+        double sc_iov {};
         long bs {};
         double bw_rdev {};
+        double sc_fsync {};
+        double sc_fdatasync {};
+        double sc_pf {};
 
         double bw_dev {};
+        // extra time of writing an extent that does not continue the previous one
+        double wb_pos {};
+        // write cache of the device, e.g. the SLC cache of an SSD: bytes written at bw_dev before the bandwidth
+        // drops to bw_dev_sustained and bytes per second of idle time it is freed at, 0 if no drop was measured
+        long wcache_size {};
+        double bw_dev_sustained {};
+        double wcache_recovery {};
+        // the calibration of the write cache writes up to 64 GiB and idles for a minute, it only runs if the
+        // config section sets device_write_cache_calibration to 1 and lacks the write cache parameters
+        bool calibrate_write_cache {};
         double bw_sync {};
         double bw_ramdisk {};
         long limit_bg {};
         long limit_hard {};
+        // the vm.dirty_* settings the limits are derived from, the bytes settings take precedence if not 0
+        int dirty_ratio {};
+        int dirty_background_ratio {};
+        long dirty_bytes {};
+        long dirty_background_bytes {};
+        long dirtyable_memory {};
+        // max_ratio of the backing device of the measured path in percent, see strictlimit_throttle
+        int bdi_max_ratio {100};
+        // set if the process runs in a cgroup v2 with a memory limit
+        std::optional <memcg_env> memcg {};
+        long cache_capacity {};
         int dirty_expire {};
+        // interval of the periodic flusher wakeups in seconds, 0 disables them
+        double dirty_writeback {};
         double coeff_bg {};
 
         double bw_mem {};
@@ -126,14 +215,21 @@ namespace measurement {
         long pagesize {};
         double lib_metacost {};
 
+        parameter_spread spread {};
+
         system_env (const std::string &device_path, const std::string &config_file):
-        conf {config_file},
+        config_file {config_file},
         device {device_path},
         dummyfile {device_path + "/dummyfile"} {
 
             const auto &[bg, hard] = fetch_dirty_limits ();
             limit_bg = bg;
             limit_hard = hard;
+            cache_capacity = fetch_page_cache_capacity ();
+            fetch_dirty_settings ();
+            dirtyable_memory = fetch_dirtyable_memory ();
+            memcg = fetch_memcg ();
+            bdi_max_ratio = fetch_bdi_max_ratio (device_path);
 
             if (!load_from_config ()) {
                 measure_host ();
@@ -144,7 +240,40 @@ namespace measurement {
         explicit system_env (const std::string &device_path):
         system_env (device_path, default_config_file) {}
 
+        // copies keep the calibrated parameters and may be modified to describe host variants
+        system_env (const system_env &) = default;
+
         void measure_host ();
+
+        /**
+         * A host variant with the calibrated parameters drawn from log-normal distributions around them with
+         * the measured spread, for Monte Carlo runs of the model. The same engine state gives the same variant.
+         */
+        [[nodiscard]] system_env sample (std::mt19937_64 &engine) const;
+
+        /**
+         * Memory the dirty limits are relative to: free memory plus the file pages of the page cache. It
+         * shrinks when applications allocate, so sampling it over time gives the input of dynamic limits.
+         */
+        [[nodiscard]] static long fetch_dirtyable_memory ();
+
+        // bytes dirtied on the node since boot, nr_dirtied of /proc/vmstat
+        [[nodiscard]] static long fetch_nr_dirtied ();
+
+        /**
+         * The background and hard dirty limits the kernel derives from the vm.dirty_* settings for the given
+         * dirtyable memory.
+         */
+        [[nodiscard]] std::pair <long, long> dirty_limits (long dirtyable_memory) const;
+
+        /**
+         * The dirty limits of the memory cgroup, relative to its file pages plus its headroom below memory.max
+         * and memory.high, as the kernel computes them for cgroup writeback. Byte settings are scaled down by
+         * the share of the cgroup in the global dirtyable memory.
+         *
+         * @param dirtyable_memory      the global dirtyable memory
+         */
+        [[nodiscard]] std::pair <long, long> memcg_dirty_limits (long dirtyable_memory) const;
         
         static void blocking_sync ();
 
@@ -156,14 +285,26 @@ namespace measurement {
                 << ", sc_sw " << sys.sc_sw
                 << ", pg_size " << sys.pagesize
                 << ", sc_sk " << sys.sc_sk
+                << ", sc_iov " << sys.sc_iov
+                << ", sc_fsync " << sys.sc_fsync
+                << ", sc_fdatasync " << sys.sc_fdatasync
+                << ", sc_pf " << sys.sc_pf
                 << ", bs " << sys.bs
                 << ", bw_rdev " << sys.bw_rdev / gb
                 << ", bw_dev " << sys.bw_dev / gb
+                << ", wb_pos " << sys.wb_pos
+                << ", wcache_size " << static_cast <double> (sys.wcache_size) / gb
+                << ", bw_dev_sustained " << sys.bw_dev_sustained / gb
+                << ", wcache_recovery " << sys.wcache_recovery / gb
                 << ", bw_sync " << sys.bw_sync / gb
                 << ", bw_ramdisk " << sys.bw_ramdisk / gb
                 << ", limit_bg " << sys.limit_bg / gb
                 << ", limit_hard " << sys.limit_hard /gb
+                << ", cache_capacity " << sys.cache_capacity / gb
+                << ", bdi_max_ratio " << sys.bdi_max_ratio
+                << ", memcg_limit " << (sys.memcg ? sys.memcg->limit () / gb : -1.0)
                 << ", dirty_expire " << sys.dirty_expire
+                << ", dirty_writeback " << sys.dirty_writeback
                 << ", coeff_bg " << sys.coeff_bg
                 << ", bw_mem " << sys.bw_mem / gb
                 << ", libc_latency " << sys.lib_metacost
@@ -21,7 +21,9 @@
 #define EVALUATION_TIMER_PACK_HPP
 
 #include <array>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 
 namespace measurement {
 
@@ -31,6 +33,7 @@ namespace measurement {
         std::array <std::chrono::time_point <std::chrono::steady_clock>, ntimers> timers {};
         std::array <std::chrono::duration <double>, ntimers> total_durations {};
         std::array <std::chrono::duration <double>, ntimers> durations {};
+        std::array <double, ntimers> squared_durations {};
         std::array <long, ntimers> counts {};
     public:
 
@@ -42,6 +45,7 @@ namespace measurement {
             auto now = std::chrono::steady_clock::now ();
             durations.at (id) = now - timers.at (id);
             total_durations.at (id) += durations.at (id);
+            squared_durations.at (id) += durations.at (id).count () * durations.at (id).count ();
             counts.at (id)++;
         }
 
@@ -53,6 +57,12 @@ namespace measurement {
             return total_durations.at (id).count () / counts.at (id);
         }
 
+        // standard deviation of the timed durations
+        inline double stddev_duration (int id) {
+            const double avg = avg_duration (id);
+            return std::sqrt (std::max (0.0, squared_durations.at (id) / counts.at (id) - avg * avg));
+        }
+
         constexpr inline double duration (int id) {
             return durations.at (id).count ();
         }
@@ -69,6 +79,7 @@ namespace measurement {
             counts.at (id) = 0;
             durations.at (id) = {};
             total_durations.at (id) = {};
+            squared_durations.at (id) = {};
             timers.at (id) = {};
         }
 
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <numeric>
+#include <cmath>
 #include <sys/wait.h>
 
 namespace measurement {
@@ -94,6 +95,24 @@ namespace measurement {
 
 
         }
+
+        /**
+         * Relative standard deviation of the measurements around a fitted line, i.e. how much a single
+         * measurement scatters around the value the regression predicts for it.
+         *
+         * @param regr      intercept and slope as returned by linear_regression
+         */
+        template <typename T>
+        static double relative_residual (const std::vector<T> &x_set, const std::vector<T> &y_set,
+                                         std::pair <double, double> regr) {
+            double sum {};
+            for (std::size_t i = 0; i < x_set.size (); ++i) {
+                const double fit = regr.first + regr.second * x_set.at (i);
+                const double rel = (y_set.at (i) - fit) / fit;
+                sum += rel * rel;
+            }
+            return x_set.empty () ? 0.0 : std::sqrt (sum / static_cast <double> (x_set.size ()));
+        }
     };
 }
 
@@ -0,0 +1,99 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_BANDWIDTH_ESTIMATOR_HPP
+#define EVALUATION_BANDWIDTH_ESTIMATOR_HPP
+
+#include <algorithm>
+
+namespace model {
+
+    /**
+     * Windowed estimate of the bandwidth of a writer, like the write bandwidth estimate of the kernel. Completed
+     * writes are collected for at least interval seconds of model time, then the bandwidth of the window is
+     * blended into the estimate with the weight of the window's length in the smoothing period. Until the
+     * first window is complete the estimate is the bandwidth of the writes so far.
+     */
+    class bandwidth_estimator {
+    private:
+        double window_start {};
+        long window_bytes {};
+        double window_io_time {};
+        double estimate {};
+        bool settled {};
+
+    public:
+        // BANDWIDTH_INTERVAL and roundup_pow_of_two (3 * HZ) of the kernel with HZ = 1000
+        static constexpr double interval = 0.2;
+        static constexpr double period = 4.096;
+
+        [[nodiscard]] inline double value () const noexcept {
+            return estimate;
+        }
+
+        [[nodiscard]] inline bool is_settled () const noexcept {
+            return settled;
+        }
+
+        // time since the current window started, the writes collected in it and their duration
+        [[nodiscard]] inline double window_age (double now) const noexcept {
+            return now - window_start;
+        }
+
+        [[nodiscard]] inline long window_size () const noexcept {
+            return window_bytes;
+        }
+
+        [[nodiscard]] inline double window_time () const noexcept {
+            return window_io_time;
+        }
+
+        /**
+         * Accounts a completed write.
+         *
+         * @param size      bytes written
+         * @param cost      the time the write took
+         * @param now       model time of its completion
+         */
+        inline void add (long size, double cost, double now) noexcept {
+            window_bytes += size;
+            window_io_time += cost;
+            if (window_io_time <= 0.0) {
+                return;
+            }
+            const double bw = static_cast <double> (window_bytes) / window_io_time;
+            const double elapsed = now - window_start;
+            if (elapsed < interval) {
+                if (!settled) {
+                    estimate = bw;
+                }
+                return;
+            }
+            const double weight = std::min (elapsed, period) / period;
+            estimate = settled ? estimate * (1.0 - weight) + bw * weight : bw;
+            settled = true;
+            window_start = now;
+            window_bytes = 0;
+            window_io_time = 0.0;
+        }
+
+        // moves the current window by dt into the future
+        inline void shift (double dt) noexcept {
+            window_start += dt;
+        }
+    };
+}
+
+#endif //EVALUATION_BANDWIDTH_ESTIMATOR_HPP
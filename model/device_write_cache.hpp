@@ -0,0 +1,116 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_DEVICE_WRITE_CACHE_HPP
+#define EVALUATION_DEVICE_WRITE_CACHE_HPP
+
+#include <algorithm>
+#include <limits>
+
+namespace model {
+
+    /**
+     * Write cache of an SSD, e.g. the SLC cache of TLC and QLC drives. Writes run at the full bandwidth of the
+     * device until capacity bytes are cached, beyond that at the sustained fraction of it. While the device is
+     * idle the cache is freed at the recovery rate in bytes per second. A capacity of 0 models no such cache.
+     */
+    class device_write_cache {
+    private:
+        long capacity {};
+        double sustained {1.0};
+        double recovery {};
+        double filled {};
+        // end of the last write, the device is idle after it
+        double last {};
+
+        [[nodiscard]] inline double headroom (double now) const noexcept {
+            if (capacity <= 0) {
+                return std::numeric_limits <double>::infinity ();
+            }
+            const double freed = now > last ? (now - last) * recovery : 0.0;
+            return static_cast <double> (capacity) - std::max (0.0, filled - freed);
+        }
+
+        inline void fill (double bytes, double now, double end) noexcept {
+            if (capacity > 0) {
+                filled = std::min (static_cast <double> (capacity), static_cast <double> (capacity) - headroom (now) + bytes);
+            }
+            last = std::max (last, end);
+        }
+
+    public:
+
+        device_write_cache () = default;
+
+        /**
+         * @param capacity      bytes written at full bandwidth
+         * @param sustained     bandwidth beyond the cache as a fraction of the full bandwidth
+         * @param recovery      bytes per second of idle time the cache is freed at
+         */
+        device_write_cache (long capacity, double sustained, double recovery) :
+        capacity {capacity}, sustained {sustained}, recovery {recovery} {}
+
+        // bandwidth of a write starting at time now as a fraction of the full bandwidth
+        [[nodiscard]] inline double factor (double now) const noexcept {
+            return headroom (now) > 0.0 ? 1.0 : sustained;
+        }
+
+        [[nodiscard]] inline double fill_level () const noexcept {
+            return filled;
+        }
+
+        // time since the end of the last write
+        [[nodiscard]] inline double idle (double now) const noexcept {
+            return now - last;
+        }
+
+        /**
+         * Time a write starting at time now takes.
+         *
+         * @param bytes     bytes written to the device
+         * @param bw        full bandwidth of the device
+         */
+        [[nodiscard]] inline double write_time (double bytes, double bw, double now) const noexcept {
+            const double fast = std::min (bytes, headroom (now));
+            return fast / bw + (bytes - fast) / (bw * sustained);
+        }
+
+        // writes data starting at time now and returns the time it takes
+        inline double write (double bytes, double bw, double now) noexcept {
+            const double cost = write_time (bytes, bw, now);
+            fill (bytes, now, now + cost);
+            return cost;
+        }
+
+        /**
+         * Writes as much data as fits in duration seconds starting at time now.
+         *
+         * @return          bytes written to the device
+         */
+        inline double write_for (double duration, double bw, double now) noexcept {
+            const double room = headroom (now);
+            const double bytes = duration * bw <= room ? duration * bw : room + (duration - room / bw) * bw * sustained;
+            fill (bytes, now, now + duration);
+            return bytes;
+        }
+
+        // moves the time of the last write by dt into the future
+        inline void shift (double dt) noexcept {
+            last += dt;
+        }
+    };
+}
+
+#endif //EVALUATION_DEVICE_WRITE_CACHE_HPP
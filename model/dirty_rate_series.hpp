@@ -0,0 +1,95 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_DIRTY_RATE_SERIES_HPP
+#define EVALUATION_DIRTY_RATE_SERIES_HPP
+
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cassert>
+
+namespace model {
+
+    /**
+     * Piecewise constant rate in bytes per second at which other processes dirty data, over model time. The
+     * rate of the last piece holds forever, before the first piece the rate is 0.
+     */
+    class dirty_rate_series {
+    private:
+        std::vector <double> starts {};
+        std::vector <double> rates {};
+
+    public:
+
+        dirty_rate_series () = default;
+
+        dirty_rate_series (std::span <const double> start_times, std::span <const double> piece_rates) :
+        starts (start_times.begin (), start_times.end ()), rates (piece_rates.begin (), piece_rates.end ()) {
+            assert (starts.size () == rates.size () && std::is_sorted (starts.begin (), starts.end ()));
+        }
+
+        static inline dirty_rate_series constant (double rate) {
+            const double start = 0.0;
+            return {{&start, 1}, {&rate, 1}};
+        }
+
+        /**
+         * Rates between consecutive samples of a cumulative counter of dirtied bytes, e.g. nr_dirtied of
+         * /proc/vmstat as returned by measurement::system_env::fetch_nr_dirtied. The last rate holds on.
+         *
+         * @param times     sample times on the model clock, increasing
+         * @param dirtied   the counter at each sample
+         */
+        static inline dirty_rate_series from_samples (std::span <const double> times, std::span <const long> dirtied) {
+            assert (times.size () == dirtied.size () && times.size () >= 2);
+            std::vector <double> piece_rates;
+            for (std::size_t i = 1; i < times.size (); ++i) {
+                piece_rates.push_back (static_cast <double> (dirtied [i] - dirtied [i - 1]) / (times [i] - times [i - 1]));
+            }
+            return {times.first (times.size () - 1), piece_rates};
+        }
+
+        [[nodiscard]] inline bool empty () const noexcept {
+            return starts.empty ();
+        }
+
+        // whether the rate does not change after time t anymore
+        [[nodiscard]] inline bool constant_from (double t) const noexcept {
+            return starts.empty () || starts.back () <= t;
+        }
+
+        [[nodiscard]] inline double rate (double t) const noexcept {
+            const auto pos = std::upper_bound (starts.begin (), starts.end (), t);
+            return pos == starts.begin () ? 0.0 : rates [pos - starts.begin () - 1];
+        }
+
+        // bytes dirtied in [from, to)
+        [[nodiscard]] inline double dirtied (double from, double to) const noexcept {
+            double bytes {};
+            auto i = static_cast <std::size_t> (std::upper_bound (starts.begin (), starts.end (), from) - starts.begin ());
+            double t = from;
+            double r = i == 0 ? 0.0 : rates [i - 1];
+            for (; i < starts.size () && starts [i] < to; ++i) {
+                bytes += r * (starts [i] - t);
+                t = starts [i];
+                r = rates [i];
+            }
+            return bytes + r * (to - t);
+        }
+    };
+}
+
+#endif //EVALUATION_DIRTY_RATE_SERIES_HPP
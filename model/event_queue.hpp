@@ -0,0 +1,91 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_EVENT_QUEUE_HPP
+#define EVALUATION_EVENT_QUEUE_HPP
+
+#include <queue>
+#include <vector>
+#include <limits>
+
+namespace model {
+
+    enum class event_type {
+        flusher_wakeup, block_expiry, write_start, write_completion, limit_change
+    };
+
+    struct event {
+        double time;
+        event_type type;
+        long tag;
+    };
+
+    // future events of the simulation, the earliest one first. Events of equal time keep their scheduling order
+    class event_queue {
+    private:
+        struct queued_event {
+            event ev;
+            long seq;
+        };
+
+        struct later {
+            inline bool operator () (const queued_event &a, const queued_event &b) const noexcept {
+                return a.ev.time > b.ev.time || (a.ev.time == b.ev.time && a.seq > b.seq);
+            }
+        };
+
+        std::priority_queue <queued_event, std::vector <queued_event>, later> events {};
+        long seq {};
+
+    public:
+
+        inline void schedule (double time, event_type type, long tag = 0) {
+            events.push ({{time, type, tag}, seq ++});
+        }
+
+        [[nodiscard]] inline bool empty () const noexcept {
+            return events.empty ();
+        }
+
+        [[nodiscard]] inline std::size_t size () const noexcept {
+            return events.size ();
+        }
+
+        [[nodiscard]] inline double next_time () const noexcept {
+            return events.empty () ? std::numeric_limits <double>::infinity () : events.top ().ev.time;
+        }
+
+        // moves all pending events by dt into the future
+        inline void shift (double dt) {
+            std::vector <queued_event> pending;
+            pending.reserve (events.size ());
+            for (; !events.empty (); events.pop ()) {
+                pending.push_back (events.top ());
+            }
+            for (auto &queued: pending) {
+                queued.ev.time += dt;
+                events.push (queued);
+            }
+        }
+
+        inline event pop () {
+            const auto ev = events.top ().ev;
+            events.pop ();
+            return ev;
+        }
+    };
+}
+
+#endif //EVALUATION_EVENT_QUEUE_HPP
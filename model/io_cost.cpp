@@ -17,36 +17,317 @@
 // Created by Masoud Gholami on 02.02.22.
 //
 
+#include <cassert>
+#include <cmath>
+#include <climits>
+#include <limits>
 #include "io_cost.hpp"
 
+#if __has_include (<experimental/simd>)
+#include <experimental/simd>
+#define EVALUATION_SIMD
+#endif
 
-double model::io_cost::syscall_io_cost (long size, double delay) {
-    time += delay;
-    double taskrate = sys.bw_ramdisk;
-    background_flush (delay);
-    bool exp = exist_expired_pages ();
-    bool async_run = (dirty < setpoint) && (dirty >= sys.limit_bg || exp);
-    bool throttle_run = dirty >= setpoint;
-    if (async_run) {
-        taskrate = sys.bw_ramdisk * sys.coeff_bg;
+
+template <typename Throttle>
+template <typename Flush>
+void model::basic_io_cost <Throttle>::advance (double until, Flush flush) {
+    assert (std::isfinite (until));
+    if (!std::isfinite (until)) {
+        return;
+    }
+    while (!events.empty () && events.next_time () <= until) {
+        const auto ev = events.pop ();
+        flush (ev.time);
+        handle (ev);
+    }
+    flush (until);
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::handle (const event &ev) {
+    switch (ev.type) {
+        case event_type::flusher_wakeup:
+            flushing = true;
+            break;
+        case event_type::block_expiry:
+            if (ev.time >= next_expiry) {
+                next_expiry = std::numeric_limits <double>::infinity ();
+            }
+            if (!flushing && total_dirty () < flush_limit () && (exist_expired_pages () || exist_expired_pages_complete ())) {
+                expiry_wakeups ++;
+            }
+            flushing = true;
+            break;
+        case event_type::write_start:
+            break;
+        case event_type::write_completion:
+            bw_estimate.add (inflight.size, inflight.cost, ev.time);
+            break;
+        case event_type::limit_change:
+            limit_changes --;
+            set_dirtyable_memory (ev.tag);
+            break;
+    }
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::set_dirtyable_memory (long bytes) {
+    std::tie (limit_bg, limit_hard) = sys.dirty_limits (bytes);
+    if (sys.memcg) {
+        apply_memcg_limits (bytes);
+    }
+    // lower limits may leave more dirty data than the background limit allows
+    if (total_dirty () >= flush_limit ()) {
+        flushing = true;
+    }
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::apply_memcg_limits (long dirtyable_memory) {
+    const auto [bg, hard] = sys.memcg_dirty_limits (dirtyable_memory);
+    limit_bg = std::min (limit_bg, bg);
+    limit_hard = std::min (limit_hard, hard);
+}
+
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::reclaim_penalty (long size) const noexcept {
+    if (!sys.memcg) {
+        return 0.0;
+    }
+    const long usage = sys.memcg->current + dirty + size;
+    if (usage <= sys.memcg->high) {
+        return 0.0;
     }
-    else if (throttle_run) {
-        double pos_ratio = get_pos_ratio ();
-        taskrate = bw_avg * pos_ratio;
-        taskrate = taskrate * sys.bw_ramdisk * sys.coeff_bg /
-                   (sys.bw_ramdisk * sys.coeff_bg + taskrate * (1 - sys.coeff_bg));
+    const double overage = static_cast <double> (usage - sys.memcg->high) / static_cast <double> (sys.memcg->high);
+    const double pages = static_cast <double> (size) / static_cast <double> (sys.pagesize);
+    const double penalty = overage * overage * pages;
+    return penalty < memcg_min_high_delay ? 0.0 : std::min (penalty, memcg_max_high_delay);
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::schedule_dirtyable_memory (double at, long bytes) {
+    limit_changes ++;
+    events.schedule (at, event_type::limit_change, bytes);
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::schedule_expiry (double dirtied) {
+    // expired data is written back by the next periodic wakeup of the flusher, without them it waits for the
+    // background limit
+    if (sys.dirty_writeback <= 0.0) {
+        return;
+    }
+    // only the wakeup for the oldest dirty data is pending, later ones are scheduled once it is written back
+    const double expiry = std::ceil ((dirtied + sys.dirty_expire) / sys.dirty_writeback) * sys.dirty_writeback;
+    if (expiry < next_expiry) {
+        next_expiry = expiry;
+        events.schedule (expiry, event_type::block_expiry);
     }
-    double cost = static_cast <double> (size) / taskrate + sys.sc_w;
+}
+
+template <typename Throttle>
+long model::basic_io_cost <Throttle>::writeback_chunk () const noexcept {
+    constexpr long min_writeback = 4l * 1024l * 1024l;
+    const long chunk = std::min (static_cast <long> (sys.bw_dev / 2), limit_hard / 8);
+    return (chunk + min_writeback) / min_writeback * min_writeback;
+}
+
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::syscall_io_cost (long size, double delay) {
+    return write_syscall (size, delay, sys.sc_w);
+}
+
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::writev_io_cost (std::span <const long> sizes, double delay) {
+    long size {};
+    for (const auto buffer_size: sizes) {
+        size += buffer_size;
+    }
+    // more than IOV_MAX buffers need several calls
+    const auto buffers = static_cast <long> (std::max <std::size_t> (sizes.size (), 1));
+    const long calls = (buffers + IOV_MAX - 1) / IOV_MAX;
+    const double overhead = static_cast <double> (calls) * sys.sc_w + static_cast <double> (buffers - calls) * sys.sc_iov;
+    return write_syscall (size, delay, overhead);
+}
+
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::write_syscall (long size, double delay, double overhead) {
+    advance (time + delay, [this] (double until) {background_flush (until);});
+    const double rate = taskrate (sys.bw_ramdisk, exist_expired_pages ());
+    const double cost = static_cast <double> (size) / rate + overhead + reclaim_penalty (size);
     dirty += size;
     io_list.push_back ({size, time + cost});
-    bw_avg = (bw_avg * io_time + size) / (io_time + cost);
-    time += cost;
-    io_time += cost;
-    background_flush (cost);
+    schedule_expiry (time + cost);
+    if (!flushing && total_dirty () >= flush_limit ()) {
+        events.schedule (time, event_type::flusher_wakeup);
+    }
+    inflight = {size, cost};
+    events.schedule (time + cost, event_type::write_completion);
+    advance (time + cost, [this] (double until) {background_flush (until);});
     return cost;
 }
 
-double model::io_cost::library_io_cost (long size, double delay) {
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::periodic_io_cost (long size, double period, long iterations) {
+
+    std::deque <periodic_state> history;
+    double total {};
+
+    for (long i = 0; i < iterations;) {
+        const double cost = syscall_io_cost (size, period);
+        total += cost;
+        ++ i;
+
+        history.push_back (periodic_snapshot (cost));
+        if (history.size () > (steady_repeats + 1) * steady_max_cycle) {
+            history.pop_front ();
+        }
+
+        // looking once per possible cycle length is enough to find a steady state soon after it is reached
+        if (i % steady_max_cycle != 0) {
+            continue;
+        }
+        const long cycle = steady_cycle (history);
+        if (cycle == 0 || limit_changes > 0 || !background.constant_from (time)) {
+            continue;
+        }
+
+        const long cycles = (iterations - i) / cycle;
+        // a cycle the plain loop does not repeat is only apparent, the iterations are simulated on
+        if (cycles == 0 || !confirm_cycle (history, cycle, size, period)) {
+            continue;
+        }
+        double cycle_cost {};
+        for (auto pos = history.end () - cycle; pos != history.end (); ++pos) {
+            cycle_cost += pos->cost;
+        }
+        fast_forward (cycles, cycle, cycle_cost, period);
+        total += static_cast <double> (cycles) * cycle_cost;
+        i += cycles * cycle;
+        history.clear ();
+    }
+
+    return total;
+}
+
+template <typename Throttle>
+typename model::basic_io_cost <Throttle>::periodic_state
+model::basic_io_cost <Throttle>::periodic_snapshot (double cost) const noexcept {
+    const double phase = sys.dirty_writeback > 0.0 ? std::fmod (time, sys.dirty_writeback) / sys.dirty_writeback : 0.0;
+    return {time, cost, dirty, io_list.size (), flushing,
+            io_list.empty () ? 0.0 : time - io_list.front ().endtime, io_list.empty () ? 0 : io_list.front ().size,
+            next_expiry - time, wcache.fill_level (), wcache.idle (time),
+            bw_estimate.value (), bw_estimate.is_settled (), bw_estimate.window_age (time), bw_estimate.window_size (),
+            bw_estimate.window_time (), foreign_dirty, phase, expiry_wakeups};
+}
+
+template <typename Throttle>
+bool model::basic_io_cost <Throttle>::same_state (const periodic_state &a, const periodic_state &b, bool phased) noexcept {
+    auto close = [] (double x, double y) {
+        return x == y || std::abs (x - y) <= steady_tolerance * std::max (std::abs (x), std::abs (y));
+    };
+    // differences of model times are rounded relative to the model time
+    const double time_tolerance = steady_time_tolerance * std::max ({1.0, std::abs (a.time), std::abs (b.time)});
+    auto close_time = [time_tolerance] (double x, double y) {
+        return x == y || std::abs (x - y) <= time_tolerance;
+    };
+    const double phase_shift = std::abs (a.phase - b.phase);
+    return a.flushing == b.flushing && a.pending_writes == b.pending_writes && a.bw_settled == b.bw_settled &&
+           a.oldest_size == b.oldest_size && a.bw_window_size == b.bw_window_size &&
+           a.dirty == b.dirty && close (a.cost, b.cost) &&
+           close (a.cache_fill, b.cache_fill) && close (a.bw_estimate, b.bw_estimate) &&
+           close (a.foreign_dirty, b.foreign_dirty) && close_time (a.oldest_age, b.oldest_age) &&
+           close_time (a.cache_idle, b.cache_idle) && close_time (a.bw_window_age, b.bw_window_age) &&
+           close_time (a.bw_window_time, b.bw_window_time) &&
+           (!phased || (std::min (phase_shift, 1.0 - phase_shift) <= steady_tolerance &&
+                        close_time (a.next_expiry_in, b.next_expiry_in)));
+}
+
+template <typename Throttle>
+bool model::basic_io_cost <Throttle>::wakeups_matter (const std::deque <periodic_state> &history, long from) const noexcept {
+    if (sys.dirty_writeback <= 0.0) {
+        return false;
+    }
+    const auto n = static_cast <long> (history.size ());
+    if (history [n - 1].expiry_wakeups != history [from].expiry_wakeups) {
+        return true;
+    }
+    // the data ages until the next sample, the last one is taken as far apart as the one before it
+    for (long k = std::max (from, 1l); k < n; ++k) {
+        const double until_next = k + 1 < n ? history [k + 1].time - history [k].time : history [k].time - history [k - 1].time;
+        if (history [k].pending_writes > 0 && history [k].oldest_age + until_next >= sys.dirty_expire) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Throttle>
+long model::basic_io_cost <Throttle>::steady_cycle (const std::deque <periodic_state> &history) const noexcept {
+
+    const auto n = static_cast <long> (history.size ());
+    for (long cycle = 1; cycle <= steady_max_cycle; ++cycle) {
+        const long window = (steady_repeats + 1) * cycle;
+        if (window > n) {
+            break;
+        }
+        // the bandwidth estimate changes once per interval, a shorter span may not show its changes
+        if (history [n - 1].time - history [n - window].time < bandwidth_estimator::interval) {
+            continue;
+        }
+        // the newest states differ first while the model is still settling, the wakeups are looked at last
+        auto repeats = [&history, n, window, cycle] (bool phased) {
+            for (long k = n - 1; k >= n - window + cycle; --k) {
+                if (!same_state (history [k], history [k - cycle], phased)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        if (repeats (false) && (!wakeups_matter (history, n - window) || repeats (true))) {
+            return cycle;
+        }
+    }
+    return 0;
+}
+
+template <typename Throttle>
+bool model::basic_io_cost <Throttle>::confirm_cycle (const std::deque <periodic_state> &history, long cycle,
+                                                     long size, double period) const {
+    basic_io_cost probe {*this, without_cache_t {}};
+    const auto n = static_cast <long> (history.size ());
+    for (long k = n - cycle; k < n; ++k) {
+        const double cost = probe.syscall_io_cost (size, period);
+        const bool phased = probe.expiry_wakeups != expiry_wakeups || wakeups_matter (history, n - (steady_repeats + 1) * cycle);
+        if (!same_state (probe.periodic_snapshot (cost), history [k], phased)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::fast_forward (long cycles, long cycle_length, double cycle_cost, double period) {
+
+    const double shift = static_cast <double> (cycles) * (static_cast <double> (cycle_length) * period + cycle_cost);
+
+    // in steady state the dirty data of the skipped cycles is written back at the rate it is produced, so the
+    // model state is the current one moved to the end of the skipped cycles
+    time += shift;
+    for (auto &io: io_list) {
+        io.endtime += shift;
+    }
+    events.shift (shift);
+    next_expiry += shift;
+
+    // the bandwidth estimate and the device cache repeat with the cycle, their times move with it
+    bw_estimate.shift (shift);
+    wcache.shift (shift);
+}
+
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::library_io_cost (long size, double delay) {
     double cost = sys.lib_metacost;
     if (size <= sys.bf - pending) {
         cost += static_cast <double> (size) / sys.bw_mem;
@@ -69,166 +350,439 @@ double model::io_cost::library_io_cost (long size, double delay) {
     return cost;
 }
 
-void model::io_cost::background_flush (double interval) {
-    while (exist_expired_pages() || dirty >= sys.limit_bg) {
-        long to_be_cleaned_size = io_list.at (id_clean).size;
-        const double sync_time = static_cast <double> (to_be_cleaned_size) / sys.bw_sync;
-        if (interval >= sync_time) {
-            interval -= sync_time;
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::background_load (double until, double bw) {
+    if (background.empty () || until <= time) {
+        return 1.0;
+    }
+    const double total = static_cast <double> (dirty) + foreign_dirty;
+    const double share = total > 0.0 ? static_cast <double> (dirty) / total : 1.0;
+
+    // beyond the setpoint the other processes dirty at most at the rate their data is written back, scaled by
+    // the position ratio, as the balanced dirty ratelimit of the kernel does. This holds them around the
+    // setpoint and stops them at the hard limit. The steps let the throttling follow their dirty data
+    const long setpoint = (limit_bg + limit_hard) / 2;
+    const double room = std::max (0.0, static_cast <double> (limit_hard - dirty));
+    const double step = std::max (background_step, (until - time) / background_max_steps);
+    for (double t = time; t < until;) {
+        const double next = std::min (until, t + step);
+        double dirtied = background.dirtied (t, next);
+        if (total_dirty () >= setpoint) {
+            const double balanced = (next - t) * bw * (1.0 - share);
+            dirtied = std::min (dirtied, balanced * std::max (0.0, pos_ratio (total_dirty (), setpoint, limit_hard)));
+        }
+
+        const double before = foreign_dirty;
+        double written {};
+        foreign_dirty += dirtied;
+        if (total_dirty () >= flush_limit ()) {
+            written = std::min (foreign_dirty, (next - t) * bw * (1.0 - share));
+            foreign_dirty -= written;
+        }
+        else {
+            foreign_dirty = std::min (foreign_dirty, background.rate (next) * sys.dirty_expire);
+        }
+        // their excess beyond the hard limit, e.g. after the limits were lowered, is only reduced by the writeback
+        if (foreign_dirty > room) {
+            foreign_dirty = std::max (room, std::min (foreign_dirty, before - written));
+        }
+        t = next;
+    }
+
+    if (!flushing && dirty > 0 && total_dirty () >= flush_limit ()) {
+        flushing = true;
+    }
+    return share;
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::background_flush (double until) {
+    // the data of other processes shares the device and its write cache
+    const double share = background_load (until, sys.bw_sync * wcache.factor (time));
+    while (flushing && time < until) {
+        if (io_list.empty () || !(exist_expired_pages () || total_dirty () >= flush_limit ())) {
+            // nothing to do until more data is dirtied or expires
+            flushing = false;
+            if (!io_list.empty ()) {
+                schedule_expiry (io_list.front ().endtime);
+            }
+            break;
+        }
+        long to_be_cleaned_size = io_list.front ().size;
+        const double device_bytes = static_cast <double> (to_be_cleaned_size) / share;
+        const double sync_time = wcache.write_time (device_bytes, sys.bw_sync, time);
+        if (until - time >= sync_time) {
+            wcache.write (device_bytes, sys.bw_sync, time);
+            time += sync_time;
             dirty -= to_be_cleaned_size;
-            id_clean ++;
+            io_list.pop_front ();
         }
         else {
-            const long interval_size = static_cast <long> (interval * sys.bw_sync);
-            io_list.at (id_clean).size = to_be_cleaned_size - interval_size;
+            const auto interval_size = static_cast <long> (wcache.write_for (until - time, sys.bw_sync, time) * share);
+            io_list.front ().size = to_be_cleaned_size - interval_size;
             dirty -= interval_size;
             break;
         }
     }
+    time = until;
 }
 
-double model::io_cost::syscall_io_cost_complete (double delay, int fd, long offset, long size) {
-
-    time += delay;
-    double taskrate = sys.bw_ramdisk;
-    background_flush_complete (delay);
-    const bool exp = exist_expired_pages_complete ();
-    const bool async_run = (dirty < setpoint) && (dirty >= sys.limit_bg || exp);
-    const bool throttle_run = dirty >= setpoint;
-    if (async_run) {
-        taskrate = sys.bw_ramdisk * sys.coeff_bg;
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::read_modify_write_penalty (int fd, long offset, long size) {
+    if (size <= 0) {
+        return 0.0;
+    }
+    const long end = offset + size;
+    const long first = offset / sys.pagesize * sys.pagesize;
+    const long last = (end - 1) / sys.pagesize * sys.pagesize;
+    const long eof = file_end [fd];
+
+    long reads {};
+    const auto read_page = [this, fd, eof, &reads] (long page) {
+        if (page < eof && cache.resident (fd, page, sys.pagesize) < sys.pagesize) {
+            ++reads;
+        }
+    };
+    if (offset != first) {
+        read_page (first);
     }
-    else if (throttle_run) {
-        const double pos_ratio = get_pos_ratio ();
-        taskrate = std::min (bw_avg * pos_ratio, sys.bw_ramdisk * sys.coeff_bg);
-//        taskrate = bw_avg * pos_ratio;
-//        taskrate = taskrate * sys.bw_ramdisk * sys.coeff_bg /
-//                   (sys.bw_ramdisk * sys.coeff_bg + taskrate * (1 - sys.coeff_bg));
+    if (end % sys.pagesize != 0 && (last != first || offset == first)) {
+        read_page (last);
     }
-    const double cost = static_cast <const double> (size) / taskrate + sys.sc_w;
+    rmw_pages += reads;
+    return static_cast <double> (reads * sys.pagesize) / sys.bw_rdev;
+}
 
-    const data_block dblock {fd, offset, size, time + cost};
-    place_data_block_in_cache (dblock);
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::complete_write (int fd, long offset, long size, double cost) {
 
-    bw_avg = (bw_avg * io_time + size) / (io_time + cost);
-    time += cost;
-    io_time += cost;
+    if (size <= 0) {
+        // nothing is dirtied, the syscall only takes its time
+        advance (time + cost, [this] (double until) {background_flush_complete (until);});
+        return;
+    }
 
-    background_flush_complete (cost);
+    // the kernel dirties whole pages
+    const long first = offset / sys.pagesize * sys.pagesize;
+    const long last = (offset + size + sys.pagesize - 1) / sys.pagesize * sys.pagesize;
+    auto &eof = file_end [fd];
+    eof = std::max (eof, offset + size);
 
-    return cost;
-}
+    const data_block dblock {fd, first, last - first, time + cost, false};
+    place_data_block_in_cache (dblock);
+    if (!flushing && total_dirty () >= flush_limit ()) {
+        events.schedule (time, event_type::flusher_wakeup);
+    }
 
-void model::io_cost::background_flush_complete (double interval) {
+    inflight = {size, cost};
+    events.schedule (time + cost, event_type::write_completion);
+    advance (time + cost, [this] (double until) {background_flush_complete (until);});
+}
 
-    static auto inactive_pred = [] (const auto &data) {return data.active == false;};
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::syscall_io_cost_complete (double delay, int fd, long offset, long size) {
 
-    while (exist_expired_pages_complete () || dirty >= sys.limit_bg) {
+    advance (time + delay, [this] (double until) {background_flush_complete (until);});
+    const double rate = taskrate_complete (sys.bw_ramdisk, exist_expired_pages_complete ());
+    const double cost = static_cast <double> (size) / rate + sys.sc_w + reclaim_penalty (size) +
+                        read_modify_write_penalty (fd, offset, size);
+    complete_write (fd, offset, size, cost);
+    return cost;
+}
 
-        balance_active_inactive ();
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::mmap_io_cost (double delay, int fd, long offset, long size) {
 
-        auto to_be_cleaned = std::ranges::find_if (page_cache, inactive_pred);
+    advance (time + delay, [this] (double until) {background_flush_complete (until);});
 
-        const double sync_time = static_cast <double> (to_be_cleaned->size) / sys.bw_dev;//sys.bw_sync;
-        if (interval >= sync_time) {
-            interval -= sync_time;
-            dirty -= to_be_cleaned->size;
-            page_cache.erase (to_be_cleaned);
-        }
-        else {
-            const long interval_size = static_cast <long> (interval * sys.bw_dev);//sys.bw_sync);
-            to_be_cleaned->size = to_be_cleaned->size - interval_size;
-            dirty -= interval_size;
-            break;
-        }
+    // clean pages are mapped read-only, so only the pages that are completely dirty take no fault
+    const long first = offset / sys.pagesize * sys.pagesize;
+    const long last = (offset + size + sys.pagesize - 1) / sys.pagesize * sys.pagesize;
+    const long pages = (last - first) / sys.pagesize;
+    const long faults = pages - cache.dirty_bytes (fd, first, last - first) / sys.pagesize;
 
-    }
+    const double rate = taskrate_complete (sys.bw_mem, exist_expired_pages_complete ());
+    const double cost = static_cast <double> (faults) * sys.sc_pf + static_cast <double> (size) / rate +
+                        reclaim_penalty (size);
+    complete_write (fd, offset, size, cost);
+    return cost;
+}
 
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::msync_cost (int fd) {
+    return sync_file_cost (fd, sys.sc_fdatasync);
 }
 
-void model::io_cost::balance_active_inactive () {
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::read_io_cost (double delay, int fd, long offset, long size) {
 
-    if (active_pages < page_cache.size() / 2) {
-        return;
-    }
+    advance (time + delay, [this] (double until) {background_flush_complete (until);});
 
-    std::ranges::sort (page_cache, {}, &data_block::io_finish_time);
+    const long hit = cache.resident (fd, offset, size);
+    const long miss = size - hit;
+    read_hit_bytes += hit;
+    read_miss_bytes += miss;
 
-    static auto active_filter = [] (const auto &data) {return data.active == true;};
+    const double cost = sys.sc_w + static_cast <double> (hit) / sys.bw_mem + static_cast <double> (miss) / sys.bw_rdev;
+    // reads beyond the end of the file return less data, only writes extend it
+    cache.make_resident (fd, offset, size);
 
-    const auto make_inactive = active_pages - page_cache.size() / 2;
-    if (make_inactive > 0) {
-        auto active_cache = page_cache | std::views::filter (active_filter);
-        static auto make_inactive_pred = [] (auto &active) {active = false;};
-        std::ranges::for_each_n (active_cache.begin (), make_inactive, make_inactive_pred, &data_block::active);
-        active_pages -= make_inactive;
-    }
+    advance (time + cost, [this] (double until) {background_flush_complete (until);});
+    return cost;
+}
 
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::fsync_cost (int fd) {
+    return sync_file_cost (fd, sys.sc_fsync);
 }
 
-void model::io_cost::place_data_block_in_cache (const model::io_cost::data_block &dblock) {
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::fdatasync_cost (int fd) {
+    return sync_file_cost (fd, sys.sc_fdatasync);
+}
 
-    std::ranges::sort (page_cache, {}, &data_block::offset);
+template <typename Throttle>
+double model::basic_io_cost <Throttle>::sync_file_cost (int fd, double latency) {
 
-    static auto file_filter = [&dblock] (const auto &data) {return data.fd == dblock.fd;};
-    static auto range_filter = [&dblock] (const auto &data) {
-        const auto s1 = data.offset;
-        const auto e1 = data.offset + data.size;
-        const auto s2 = dblock.offset;
-        const auto e2 = dblock.offset + dblock.size;
-        const auto s1__s2__e1 = s1 <= s2 && e1 > s2;
-        const auto s2__s1__e2 = s2 <= s1 && e2 > s1;
-        return s1__s2__e1 || s2__s1__e2;
-    };
+    const auto [cleaned, runs] = cache.writeback_file (fd);
+    dirty -= cleaned;
 
-    auto covered_data = page_cache | std::views::filter (file_filter) | std::views::filter (range_filter);
+    // the pending expiry of the written back data finds nothing to do and is rescheduled by the flusher
+    const double transfer = wcache.write (static_cast <double> (cleaned), sys.bw_dev, time);
+    const double cost = transfer + static_cast <double> (runs) * sys.wb_pos + latency;
+    advance (time + cost, [this] (double until) {background_flush_complete (until);});
+    return cost;
+}
 
-    std::vector <data_block> insert_to_cache;
-    auto offset = dblock.offset;
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::background_flush_complete (double until) {
 
-    for (auto pos = covered_data.begin (); pos != covered_data.end (); pos ++) {
+    // the data of other processes shares the device and its write cache
+    const double share = background_load (until, sys.bw_dev * wcache.factor (time));
+    while (flushing && time < until) {
 
-        // evict this part of data
-        pos->evict = true;
-        dirty -= pos->size;
-        if (pos->active) {
-            active_pages --;
+        if (cache.empty () || !(exist_expired_pages_complete () || total_dirty () >= flush_limit ())) {
+            // nothing to do until more data is dirtied or expires
+            flushing = false;
+            if (!cache.empty ()) {
+                schedule_expiry (cache.oldest ());
+            }
+            break;
         }
 
-        if (offset < pos->offset) {
-            insert_to_cache.emplace_back (dblock.fd, offset, pos->offset - offset, dblock.io_finish_time, false);
-            offset = pos->offset;
+        cache.balance ();
+
+        if (wb_budget <= 0 || !cache.next_writeback (wb_fd, wb_offset)) {
+            // the file of the least recently used data is next, unless its chunk was just written
+            const int fd = cache.next_writeback ().fd;
+            wb_fd = fd == wb_fd ? cache.next_file (fd) : fd;
+            wb_offset = -1;
+            wb_budget = writeback_chunk ();
+            wb_pos_left = 0.0;
         }
-        else if (offset > pos->offset) {
-            insert_to_cache.emplace_back (dblock.fd, pos->offset, offset - pos->offset, pos->io_finish_time, pos->active);
+
+        const auto &to_be_cleaned = *cache.next_writeback (wb_fd, wb_offset);
+        const long chunk = std::min (to_be_cleaned.size, wb_budget);
+
+        // an extent that does not continue the previously written one needs positioning first
+        const double positioning = to_be_cleaned.offset == wb_offset ? wb_pos_left : sys.wb_pos;
+        const double device_bytes = static_cast <double> (chunk) / share;
+        const double sync_time = positioning + wcache.write_time (device_bytes, sys.bw_dev, time + positioning);
+        if (until - time >= sync_time) {
+            wcache.write (device_bytes, sys.bw_dev, time + positioning);
+            time += sync_time;
+            wb_offset = to_be_cleaned.offset + chunk;
+            wb_budget -= chunk;
+            wb_pos_left = 0.0;
+            dirty -= cache.writeback (to_be_cleaned, chunk);
+        }
+        else if (until - time <= positioning) {
+            // the positioning continues with the next interval
+            wb_offset = to_be_cleaned.offset;
+            wb_pos_left = positioning - (until - time);
+            break;
+        }
+        else {
+            const auto interval_size = static_cast <long> (wcache.write_for (until - time - positioning, sys.bw_dev,
+                                                                             time + positioning) * share);
+            wb_offset = to_be_cleaned.offset + interval_size;
+            wb_pos_left = 0.0;
+            if (interval_size > 0) {
+                wb_budget -= interval_size;
+                dirty -= cache.writeback (to_be_cleaned, interval_size);
+            }
+            break;
         }
 
-        const auto min_end = std::min (dblock.offset + dblock.size, pos->offset + pos->size);
-        insert_to_cache.emplace_back (dblock.fd, offset, min_end - offset, dblock.io_finish_time, true);
-        offset = min_end;
+    }
+    time = until;
 
-        if (dblock.offset + dblock.size < pos->offset + pos->size) {
-            insert_to_cache.emplace_back (dblock.fd, min_end, pos->offset + pos->size, pos->io_finish_time, pos->active);
-            offset = pos->offset + pos->size;
-        }
+}
 
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::place_data_block_in_cache (const data_block &dblock) {
+    dirty += cache.place (dblock);
+    // an empty block leaves an empty cache empty
+    if (!cache.empty ()) {
+        schedule_expiry (cache.oldest ());
     }
+}
 
-    if (offset < dblock.offset + dblock.size) {
-        insert_to_cache.emplace_back (dblock.fd, offset, dblock.offset + dblock.size - offset, dblock.io_finish_time, false);
+template <typename Throttle>
+template <typename CostFn>
+model::trace_statistics
+model::basic_io_cost <Throttle>::evaluate_trace (const write_trace &trace, std::span <double> costs, CostFn cost_fn) {
+    const auto n = trace.length ();
+    assert (trace.delays.size () == n && costs.size () >= n);
+
+    trace_statistics stats;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double cost = cost_fn (i);
+        costs [i] = cost;
+        stats.add (trace.sizes [i], cost);
     }
+    stats.mean = n > 0 ? stats.total / static_cast <double> (n) : 0.0;
+    return stats;
+}
 
-    std::erase_if (page_cache, [] (const auto &data) {return data.evict == true;});
+template <typename Throttle>
+template <typename CostFn>
+long model::basic_io_cost <Throttle>::max_size_within (double budget, CostFn cost) {
+    if (cost (0) > budget) {
+        return 0;
+    }
+    // doubling brackets the size, bisection narrows the bracket down to a byte
+    long lo = 0;
+    long hi = 1;
+    while (cost (hi) <= budget) {
+        lo = hi;
+        if (hi > std::numeric_limits <long>::max () / 2) {
+            return hi;
+        }
+        hi *= 2;
+    }
+    while (hi - lo > 1) {
+        const long mid = lo + (hi - lo) / 2;
+        (cost (mid) <= budget ? lo : hi) = mid;
+    }
+    return lo;
+}
 
-    static auto update_meta_info = [this] (const auto &data) {
-        dirty += data.size;
-        if (data.active) {
-            active_pages ++;
+template <typename Throttle>
+long model::basic_io_cost <Throttle>::max_syscall_size (double budget, double delay) const {
+    basic_io_cost probe {*this, without_cache_t {}};
+    probe.advance (probe.time + delay, [&probe] (double until) {probe.background_flush (until);});
+    const double rate = probe.taskrate (sys.bw_ramdisk, probe.exist_expired_pages ());
+    return max_size_within (budget, [&probe, rate] (long size) {
+        return static_cast <double> (size) / rate + probe.sys.sc_w + probe.reclaim_penalty (size);
+    });
+}
+
+template <typename Throttle>
+long model::basic_io_cost <Throttle>::max_syscall_size_complete (double budget, double delay, int fd, long offset) const {
+    auto probe {*this};
+    probe.advance (probe.time + delay, [&probe] (double until) {probe.background_flush_complete (until);});
+    const double rate = probe.taskrate_complete (sys.bw_ramdisk, probe.exist_expired_pages_complete ());
+    return max_size_within (budget, [&probe, rate, fd, offset] (long size) {
+        return static_cast <double> (size) / rate + probe.sys.sc_w + probe.reclaim_penalty (size) +
+               probe.read_modify_write_penalty (fd, offset, size);
+    });
+}
+
+template <typename Throttle>
+long model::basic_io_cost <Throttle>::max_library_size (double budget, double delay) const {
+    // the costs of filling the buffer and of writing it do not depend on the size, see library_io_cost
+    const long room = sys.bf - pending;
+    const double fill = sys.lib_metacost + static_cast <double> (room) / sys.bw_mem;
+    basic_io_cost probe {*this, without_cache_t {}};
+    const double first = probe.syscall_io_cost (sys.bf, pending_delay + delay + fill);
+    probe.advance (probe.time, [&probe] (double until) {probe.background_flush (until);});
+    const double rate = probe.taskrate (sys.bw_ramdisk, probe.exist_expired_pages ());
+
+    return max_size_within (budget, [this, &probe, room, fill, first, rate] (long size) {
+        if (size <= room) {
+            return sys.lib_metacost + static_cast <double> (size) / sys.bw_mem;
         }
-    };
+        const long rest = size - room;
+        const long rem = rest % sys.bf;
+        double cost = fill + first + static_cast <double> (rem) / sys.bw_mem;
+        if (rest >= sys.bf) {
+            cost += static_cast <double> (rest - rem) / rate + sys.sc_w + probe.reclaim_penalty (rest - rem);
+        }
+        return cost;
+    });
+}
+
+template <typename Throttle>
+model::trace_statistics model::basic_io_cost <Throttle>::syscall_io_cost (const write_trace &trace, std::span <double> costs) {
+    return evaluate_trace (trace, costs, [this, &trace] (std::size_t i) {
+        return syscall_io_cost (trace.sizes [i], trace.delays [i]);
+    });
+}
 
-    std::ranges::for_each (insert_to_cache, update_meta_info);
+template <typename Throttle>
+model::trace_statistics model::basic_io_cost <Throttle>::syscall_io_cost_complete (const write_trace &trace, std::span <double> costs) {
+    assert (trace.fds.size () == trace.length () && trace.offsets.size () == trace.length ());
+    return evaluate_trace (trace, costs, [this, &trace] (std::size_t i) {
+        return syscall_io_cost_complete (trace.delays [i], trace.fds [i], trace.offsets [i], trace.sizes [i]);
+    });
+}
+
+template <typename Throttle>
+model::trace_statistics model::basic_io_cost <Throttle>::library_io_cost (const write_trace &trace, std::span <double> costs) {
+    return evaluate_trace (trace, costs, [this, &trace] (std::size_t i) {
+        return library_io_cost (trace.sizes [i], trace.delays [i]);
+    });
+}
+
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::sync_io_cost (std::span <const long> sizes, std::span <const bool> is_rnd,
+                                   std::span <double> costs) const noexcept {
+    assert (is_rnd.size () == sizes.size () && costs.size () >= sizes.size ());
+    std::size_t i = 0;
+#ifdef EVALUATION_SIMD
+    namespace stdx = std::experimental;
+    using simd_t = stdx::native_simd <double>;
+    const auto dbs = static_cast <double> (sys.bs);
+    const auto page = static_cast <double> (sys.pagesize);
+    const double rem_penalty = dbs / sys.bw_rdev + dbs / sys.bw_dev;
+    for (; i + simd_t::size () <= sizes.size (); i += simd_t::size ()) {
+        const simd_t size ([&sizes, i] (auto j) {return static_cast <double> (sizes [i + j]);});
+        const simd_t rnd ([&is_rnd, i] (auto j) {return static_cast <double> (is_rnd [i + j]);});
+        // exact for sizes below 2^53
+        const simd_t rem = size - stdx::floor (size / page) * page;
+        simd_t penalty = 0.0;
+        stdx::where (rem > 0.0, penalty) = rem_penalty;
+        const simd_t cost = sys.sc_sw + rnd * sys.sc_sk + size / sys.bw_ramdisk + (size - rem) / sys.bw_dev;
+        (cost + penalty).copy_to (&costs [i], stdx::element_aligned);
+    }
+#endif
+    for (; i < sizes.size (); ++i) {
+        costs [i] = sync_io_cost (sizes [i], is_rnd [i]);
+    }
+}
 
-//    page_cache.insert (page_cache.end(), insert_to_cache.begin(), insert_to_cache.end());
-    std::move (insert_to_cache.begin(), insert_to_cache.end(), std::back_inserter (page_cache));
+template <typename Throttle>
+void model::basic_io_cost <Throttle>::direct_io_cost (std::span <const long> sizes, std::span <const bool> is_rnd,
+                                     std::span <double> costs) const noexcept {
+    assert (is_rnd.size () == sizes.size () && costs.size () >= sizes.size ());
+    std::size_t i = 0;
+#ifdef EVALUATION_SIMD
+    namespace stdx = std::experimental;
+    using simd_t = stdx::native_simd <double>;
+    for (; i + simd_t::size () <= sizes.size (); i += simd_t::size ()) {
+        const simd_t size ([&sizes, i] (auto j) {return static_cast <double> (sizes [i + j]);});
+        const simd_t rnd ([&is_rnd, i] (auto j) {return static_cast <double> (is_rnd [i + j]);});
+        const simd_t cost = sys.sc_sw + rnd * sys.sc_sk + size / sys.bw_dev;
+        cost.copy_to (&costs [i], stdx::element_aligned);
+    }
+#endif
+    for (; i < sizes.size (); ++i) {
+        costs [i] = direct_io_cost (sizes [i], is_rnd [i]);
+    }
 }
+
+template class model::basic_io_cost <model::default_throttle>;
+template class model::basic_io_cost <model::blended_throttle>;
+template class model::basic_io_cost <model::capped_throttle>;
+template class model::basic_io_cost <model::strictlimit_throttle>;
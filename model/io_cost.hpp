@@ -21,84 +21,310 @@
 #define EVALUATION_IO_COST_HPP
 
 #include <vector>
+#include <deque>
 #include <ranges>
 #include <algorithm>
+#include <unordered_map>
 #include "../measurement/system_env.hpp"
+#include "page_cache.hpp"
+#include "write_trace.hpp"
+#include "event_queue.hpp"
+#include "throttle_policy.hpp"
+#include "dirty_rate_series.hpp"
+#include "bandwidth_estimator.hpp"
+#include "device_write_cache.hpp"
 
 namespace model {
 
-    class io_cost {
+    template <typename Throttle>
+    class basic_shared_io_cost;
+
+    /**
+     * The cost model of writes through the page cache.
+     *
+     * @tparam Throttle     the throttling policy of the modelled kernel, see throttle_policy.hpp. A
+     *                      split_throttle throttles the fast and the complete model differently
+     */
+    template <typename Throttle>
+    class basic_io_cost {
     private:
+        // the writers of the shared model dirty data through the fast model of the node
+        template <typename> friend class basic_shared_io_cost;
+
         const measurement::system_env &sys;
-        const long setpoint;
+
+        // dirty limits, they follow the dirtyable memory once it is set. In a memory cgroup the stricter of
+        // the global and the cgroup limits apply
+        long limit_bg;
+        long limit_hard;
+        long limit_changes {};
+
+        // the longest and the shortest memory.high throttling delay of the kernel
+        static constexpr double memcg_max_high_delay = 2.0;
+        static constexpr double memcg_min_high_delay = 0.01;
+        // time step of the dirtying by other processes, longer intervals take at most background_max_steps
+        static constexpr double background_step = 0.01;
+        static constexpr double background_max_steps = 1024.0;
 
         struct io_info {
             long size;
             double endtime;
         };
 
-        struct data_block {
-            int fd;
-            long offset;
-            long size;
-            double io_finish_time;
-            bool active;
-            bool evict {false};
-        };
+        using data_block = page_cache::data_block;
 
-        std::vector <io_info> io_list {};
+        // writes that are not cleaned yet, the oldest one in front
+        std::deque <io_info> io_list {};
 
-        long active_pages {};
-        std::vector <data_block> page_cache {};
+        page_cache cache {};
 
+        // the write in progress, its bandwidth is accounted at its completion event
+        struct inflight_write {
+            long size;
+            double cost;
+        };
 
+        event_queue events {};
+        inflight_write inflight {};
+        bool flushing {};
+        // the periodic wakeup of the flusher that writes back the oldest dirty data once it is expired
+        double next_expiry {std::numeric_limits <double>::infinity ()};
+        // wakeups that started the flusher for expired data, only they depend on the phase of the wakeups
+        long expiry_wakeups {};
+
+        // the file the flusher writes back, where it continues and how much it may still write before it
+        // turns to the next file
+        int wb_fd {-1};
+        long wb_offset {};
+        long wb_budget {};
+        // positioning at wb_offset that is not finished yet
+        double wb_pos_left {};
 
-        long id_clean {};
         double time {};
-        double io_time {};
-        double bw_avg {};
+        // bandwidth of the completed writes, the base of the throttled rate
+        bandwidth_estimator bw_estimate {};
+        // the writeback slows down once the write cache of the device is full
+        device_write_cache wcache {};
 
         long pending {};
         double pending_delay {};
 
+        long read_hit_bytes {};
+        long read_miss_bytes {};
+
+        // end of the data of each file known to the complete model, pages beyond it are not read before a write
+        std::unordered_map <int, long> file_end {};
+        long rmw_pages {};
+
+        // dirtying by other processes, their dirty data shares the limits and the writeback with ours
+        dirty_rate_series background {};
+        double foreign_dirty {};
+
+        [[nodiscard]] inline long total_dirty () const noexcept {
+            return dirty + static_cast <long> (foreign_dirty);
+        }
+
+        /**
+         * Dirties and writes back the data of other processes up to the given time. Above the background limit
+         * the flusher splits the writeback bandwidth by the dirty data of both, below it the data of others is
+         * written back as it expires. Like ours, their writes are throttled beyond the setpoint and never exceed
+         * the hard limit.
+         *
+         * @param bw    the writeback bandwidth
+         * @return      the share of the writeback bandwidth left for our data
+         */
+        double background_load (double until, double bw);
+
         [[nodiscard]] inline bool exist_expired_pages () const noexcept {
-            return (!io_list.empty ()) && (io_list.at (id_clean).endtime < time - sys.dirty_expire);
+            return (!io_list.empty ()) && (io_list.front ().endtime <= time - sys.dirty_expire);
         }
 
         [[nodiscard]] inline bool exist_expired_pages_complete () const noexcept {
+            return cache.expired (time - sys.dirty_expire);
+        }
 
-            if (page_cache.empty())
-                return false;
-
-            bool expired = std::any_of (page_cache.cbegin(),
-                         page_cache.cend(),
-                         [this] (const auto &dblock) {
-                return dblock.io_finish_time < time - sys.dirty_expire;
-            });
+        void apply_memcg_limits (long dirtyable_memory);
+
+        /**
+         * Delay of a write that charges size bytes of page cache to a memory cgroup beyond memory.high, as in
+         * mem_cgroup_handle_over_high. The cgroup is assumed to reclaim clean data first, so only its other
+         * usage and the dirty data count.
+         */
+        [[nodiscard]] double reclaim_penalty (long size) const noexcept;
+
+        /**
+         * Delay of reading the partially written first and last page of a write before they are modified, as
+         * the kernel does for pages that are neither resident nor beyond the end of the file.
+         */
+        double read_modify_write_penalty (int fd, long offset, long size);
+
+        // dirty data beyond which the flusher writes back in the background
+        [[nodiscard]] inline constexpr long flush_limit () const noexcept {
+            using policies = throttle_of <Throttle>;
+            return std::min (policies::fast::background_limit (limit_bg, sys.bdi_max_ratio),
+                             policies::complete::background_limit (limit_bg, sys.bdi_max_ratio));
+        }
 
-            if (expired)
-                return true;
+        [[nodiscard]] inline constexpr throttle_state throttling (double freerun, bool expired) const noexcept {
+            // before the first write completed, e.g. when others already dirtied data, the background rate is the
+            // best guess of the bandwidth
+            const double bw_avg = bw_estimate.value () > 0.0 ? bw_estimate.value () : freerun * sys.coeff_bg;
+            return {total_dirty (), limit_bg, limit_hard, expired, bw_avg, freerun, sys.coeff_bg, sys.bw_sync,
+                    sys.bdi_max_ratio};
+        }
 
-            return false;
+        // rate at which data is dirtied under the current throttling regime, freerun is the rate without it
+        [[nodiscard]] inline constexpr double taskrate (double freerun, bool expired) const noexcept {
+            return throttle_of <Throttle>::fast::taskrate (throttling (freerun, expired));
         }
 
-        [[nodiscard]] inline constexpr double get_pos_ratio () const noexcept {
-            double val = static_cast <double> (setpoint - dirty) / static_cast <double> (sys.limit_hard - setpoint);
-            return 1.0 + val * val * val;
+        [[nodiscard]] inline constexpr double taskrate_complete (double freerun, bool expired) const noexcept {
+            return throttle_of <Throttle>::complete::taskrate (throttling (freerun, expired));
         }
 
-        void background_flush (double interval);
-        void background_flush_complete (double interval);
-        void balance_active_inactive ();
+        /**
+         * Runs the simulation up to the given time. Events are handled in time order, between two events the
+         * flusher writes back dirty data as long as it is awake and has work.
+         *
+         * @param until     the time to advance to, must be finite
+         * @param flush     called as flush (t) to write back dirty data up to time t
+         */
+        template <typename Flush>
+        void advance (double until, Flush flush);
+
+        void handle (const event &ev);
+
+        void schedule_expiry (double dirtied);
+
+        /**
+         * Bytes the flusher writes back from one file before it turns to the next one, as writeback_chunk_size
+         * of the kernel: half a second of writeback or an eighth of the hard limit, rounded to 4 MiB.
+         */
+        [[nodiscard]] long writeback_chunk () const noexcept;
+
+        static constexpr long steady_max_cycle = 16;
+        static constexpr long steady_repeats = 2;
+        static constexpr double steady_tolerance = 1e-13;
+        // times are compared relative to the model time, their rounding grows with it
+        static constexpr double steady_time_tolerance = 1e-12;
+
+        // the state after an iteration of a periodic workload, times are relative to the model time
+        struct periodic_state {
+            double time;
+            double cost;
+            long dirty;
+            std::size_t pending_writes;
+            bool flushing;
+            // age and size of the oldest dirty write and the time until the next periodic wakeup
+            double oldest_age;
+            long oldest_size;
+            double next_expiry_in;
+            double cache_fill;
+            double cache_idle;
+            // the bandwidth estimate and the position in its window
+            double bw_estimate;
+            bool bw_settled;
+            double bw_window_age;
+            long bw_window_size;
+            double bw_window_time;
+            double foreign_dirty;
+            // position of the time between two periodic wakeups of the flusher, in [0, 1)
+            double phase;
+            long expiry_wakeups;
+        };
+
+        [[nodiscard]] periodic_state periodic_snapshot (double cost) const noexcept;
+
+        // the wakeups of the flusher are only compared if they may write back expired data, otherwise they find
+        // nothing to do and are rescheduled on their grid
+        [[nodiscard]] static bool same_state (const periodic_state &a, const periodic_state &b, bool phased) noexcept;
+
+        /**
+         * Whether the periodic wakeups of the flusher may write back expired data from the state at index from
+         * of the history on: they did, or the oldest dirty data may expire before it is sampled again.
+         */
+        [[nodiscard]] bool wakeups_matter (const std::deque <periodic_state> &history, long from) const noexcept;
+
+        [[nodiscard]] long steady_cycle (const std::deque <periodic_state> &history) const noexcept;
+
+        /**
+         * Whether the plain loop repeats the last cycle of the history once more, checked on a copy of the state
+         * before the cycle is extrapolated.
+         */
+        [[nodiscard]] bool confirm_cycle (const std::deque <periodic_state> &history, long cycle, long size,
+                                          double period) const;
 
+        void fast_forward (long cycles, long cycle_length, double cycle_cost, double period);
+
+        // a write syscall of the fast model with the given per call overhead
+        double write_syscall (long size, double delay, double overhead);
+
+        void background_flush (double until);
+        void background_flush_complete (double until);
 
         void place_data_block_in_cache (const data_block &dblock);
 
+        double sync_file_cost (int fd, double latency);
+
+        // dirties a block in the complete model and lets the simulation run until the write completes
+        void complete_write (int fd, long offset, long size, double cost);
+
+        // the largest size whose cost is within budget, cost is called O(log size) times
+        template <typename CostFn>
+        [[nodiscard]] static long max_size_within (double budget, CostFn cost);
+
+        struct without_cache_t {};
+
+        // copies the state of the fast model only, the page cache and the file sizes of the complete model
+        // are left empty
+        basic_io_cost (const basic_io_cost &other, without_cache_t) : sys {other.sys},
+                                                                     limit_bg {other.limit_bg},
+                                                                     limit_hard {other.limit_hard},
+                                                                     limit_changes {other.limit_changes},
+                                                                     io_list {other.io_list},
+                                                                     events {other.events},
+                                                                     inflight {other.inflight},
+                                                                     flushing {other.flushing},
+                                                                     next_expiry {other.next_expiry},
+                                                                     expiry_wakeups {other.expiry_wakeups},
+                                                                     wb_fd {other.wb_fd},
+                                                                     wb_offset {other.wb_offset},
+                                                                     wb_budget {other.wb_budget},
+                                                                     wb_pos_left {other.wb_pos_left},
+                                                                     time {other.time},
+                                                                     bw_estimate {other.bw_estimate},
+                                                                     wcache {other.wcache},
+                                                                     pending {other.pending},
+                                                                     pending_delay {other.pending_delay},
+                                                                     read_hit_bytes {other.read_hit_bytes},
+                                                                     read_miss_bytes {other.read_miss_bytes},
+                                                                     rmw_pages {other.rmw_pages},
+                                                                     background {other.background},
+                                                                     foreign_dirty {other.foreign_dirty},
+                                                                     dirty {other.dirty} {}
+
+        template <typename CostFn>
+        trace_statistics evaluate_trace (const write_trace &trace, std::span <double> costs, CostFn cost_fn);
+
     public:
         long dirty {};
 
-        explicit io_cost (const measurement::system_env &env) : sys {env},
-                                                                setpoint {(env.limit_bg + env.limit_hard) / 2} {}
+        explicit basic_io_cost (const measurement::system_env &env) : sys {env},
+                                                                      limit_bg {env.limit_bg},
+                                                                      limit_hard {env.limit_hard},
+                                                                      wcache {env.wcache_size,
+                                                                              env.bw_dev_sustained / env.bw_dev,
+                                                                              env.wcache_recovery} {
+            // an unknown capacity leaves the clean data unbounded, a memory cgroup without headroom keeps none
+            if (env.memcg) {
+                apply_memcg_limits (env.dirtyable_memory);
+                const long headroom = std::max (0l, env.memcg->limit () - env.memcg->current);
+                cache.set_capacity (env.cache_capacity > 0 ? std::min (env.cache_capacity, headroom) : headroom);
+            }
+            else if (env.cache_capacity > 0) {
+                cache.set_capacity (env.cache_capacity);
+            }
+        }
 
 
         double syscall_io_cost (long size, double delay);
@@ -107,7 +333,112 @@ namespace model {
 
         double library_io_cost (long size, double delay);
 
-        inline constexpr double sync_io_cost (long size, bool is_rnd) noexcept {
+        /**
+         * Cost of a writev call gathering several buffers into one write. Besides the syscall overhead every
+         * buffer after the first costs the calibrated sc_iov, the data is dirtied as one write. More than
+         * IOV_MAX buffers are split into several calls.
+         *
+         * @param sizes     sizes of the gathered buffers
+         */
+        double writev_io_cost (std::span <const long> sizes, double delay);
+
+        /**
+         * Cost of a read in the complete model. Data that is dirty or still resident after its writeback is
+         * served from the page cache at memory bandwidth, the rest is read from the device and stays resident.
+         */
+        double read_io_cost (double delay, int fd, long offset, long size);
+
+        /**
+         * Cost of an fsync or fdatasync on a file in the complete model, called right after the last write. The
+         * remaining dirty data of the file is written back at device bandwidth followed by the calibrated flush
+         * latency; fdatasync skips the journal commit of the metadata. The data stays resident as clean data.
+         */
+        double fsync_cost (int fd);
+
+        double fdatasync_cost (int fd);
+
+        /**
+         * Cost of storing to a shared file mapping in the complete model. Stores bypass the write syscall and
+         * copy at memory bandwidth, but every page that is not dirty yet takes a write fault, including pages
+         * that were written back since their last store. The dirty data is throttled like written data.
+         */
+        double mmap_io_cost (double delay, int fd, long offset, long size);
+
+        // msync (MS_SYNC) of the whole mapping of a file, it writes back the data like fdatasync
+        double msync_cost (int fd);
+
+        [[nodiscard]] inline std::pair <long, long> read_hits_misses () const noexcept {
+            return {read_hit_bytes, read_miss_bytes};
+        }
+
+        // pages the complete model read from the device before partially overwriting them
+        [[nodiscard]] inline long read_modify_write_pages () const noexcept {
+            return rmw_pages;
+        }
+
+        /**
+         * Sets the size of a file that exists before the modeled I/O, e.g. one opened without O_TRUNC. The
+         * complete model reads its pages that are not in the page cache before partially overwriting them.
+         */
+        inline void set_file_size (int fd, long bytes) {
+            file_end [fd] = bytes;
+        }
+
+        /**
+         * Recomputes the dirty limits and with them the setpoint from the dirtyable memory, as the kernel does
+         * when applications allocate or free memory. The limits apply from the current model time on. In a
+         * memory cgroup they are bounded by the cgroup limits.
+         */
+        void set_dirtyable_memory (long bytes);
+
+        /**
+         * Changes the dirtyable memory at a future model time, e.g. for a simulated allocation or for a sample
+         * of measurement::system_env::fetch_dirtyable_memory. Periodic workloads are not fast-forwarded while
+         * changes are pending.
+         */
+        void schedule_dirtyable_memory (double at, long bytes);
+
+        /**
+         * Sets the rate at which other processes on the node dirty data, over model time. Periodic workloads
+         * are only fast-forwarded once the rate is constant.
+         */
+        inline void set_background_load (dirty_rate_series series) {
+            background = std::move (series);
+        }
+
+        [[nodiscard]] inline long background_dirty () const noexcept {
+            return static_cast <long> (foreign_dirty);
+        }
+
+        [[nodiscard]] inline std::pair <long, long> dirty_limits () const noexcept {
+            return {limit_bg, limit_hard};
+        }
+
+        /**
+         * Cost of a periodic workload: iterations writes of size bytes, each after period seconds of compute.
+         * Once the state of the model repeats with a cycle of up to steady_max_cycle iterations over at least one
+         * window of the bandwidth estimate, and one more cycle of the plain loop on a copy of the state repeats it
+         * as well, the remaining whole cycles are skipped analytically and the model state is moved to the end of
+         * them. Otherwise the iterations are simulated one by one.
+         *
+         * @return      the cumulative cost of all iterations
+         */
+        double periodic_io_cost (long size, double period, long iterations);
+
+        /**
+         * Batch variants of the models above, evaluating a whole trace in one call.
+         *
+         * @param trace     the writes, fds and offsets are only needed by the complete model
+         * @param costs     receives the cost of every write, must hold trace.length () entries
+         * @return          aggregate statistics of the trace
+         */
+        trace_statistics syscall_io_cost (const write_trace &trace, std::span <double> costs);
+
+        trace_statistics syscall_io_cost_complete (const write_trace &trace, std::span <double> costs);
+
+        trace_statistics library_io_cost (const write_trace &trace, std::span <double> costs);
+
+        inline constexpr double sync_io_cost (long size, bool is_rnd) const noexcept {
             long rem = size % sys.pagesize;
             long fit = size - rem;
             auto dbs = static_cast <double> (sys.bs);
@@ -117,11 +448,92 @@ namespace model {
             return cost + penalty;
         }
 
-        inline double direct_io_cost (long size, bool is_rnd) noexcept {
+        inline double direct_io_cost (long size, bool is_rnd) const noexcept {
             return sys.sc_sw + is_rnd * sys.sc_sk + static_cast <double> (size) / sys.bw_dev;
         }
 
+        /**
+         * Inverse of sync_io_cost: the largest write that costs at most budget seconds, 0 if not even an empty
+         * write fits. Whole pages are cheaper per byte than a partial one, so as many pages as fit are taken
+         * and the rest of the budget goes to a partial page if it also covers its penalty. The closed form is
+         * corrected by single bytes where rounding puts it next to the size sync_io_cost accepts.
+         */
+        inline constexpr long max_sync_io_size (double budget, bool is_rnd) const noexcept {
+            const double avail = budget - sys.sc_sw - is_rnd * sys.sc_sk;
+            if (avail < 0.0) {
+                return 0;
+            }
+            const auto dbs = static_cast <double> (sys.bs);
+            const auto page = static_cast <double> (sys.pagesize);
+            const double page_cost = page / sys.bw_ramdisk + page / sys.bw_dev;
+            const auto pages = static_cast <long> (avail / page_cost);
+            const double rest = avail - static_cast <double> (pages) * page_cost - (dbs / sys.bw_rdev + dbs / sys.bw_dev);
+            const long rem = rest > 0.0 ? std::min (sys.pagesize - 1, static_cast <long> (rest * sys.bw_ramdisk)) : 0;
+            long size = pages * sys.pagesize + rem;
+            while (size > 0 && sync_io_cost (size, is_rnd) > budget) {
+                --size;
+            }
+            while (sync_io_cost (size + 1, is_rnd) <= budget) {
+                ++size;
+            }
+            return size;
+        }
+
+        // inverse of direct_io_cost, rounded down to whole logical blocks as direct I/O requires and corrected
+        // by single blocks like max_sync_io_size
+        inline long max_direct_io_size (double budget, bool is_rnd) const noexcept {
+            const double avail = budget - sys.sc_sw - is_rnd * sys.sc_sk;
+            if (avail < 0.0) {
+                return 0;
+            }
+            long size = static_cast <long> (avail * sys.bw_dev) / sys.bs * sys.bs;
+            while (size > 0 && direct_io_cost (size, is_rnd) > budget) {
+                size -= sys.bs;
+            }
+            while (direct_io_cost (size + sys.bs, is_rnd) <= budget) {
+                size += sys.bs;
+            }
+            return size;
+        }
+
+        /**
+         * Inverses of the stateful models: the largest write issued after delay that costs at most budget
+         * seconds in the current state, which is left unchanged. A write syscall is throttled at a rate fixed
+         * when it is issued, so the state is copied and advanced once and the size found by bisection on the
+         * closed cost. A library write beyond the buffer issues a syscall of the buffer, whose cost does not
+         * depend on the size, and at most one more syscall at the rate after it. The fast queries copy the
+         * state without the page cache, max_syscall_size_complete copies all of it. The costs are assumed to
+         * grow with the size.
+         */
+        [[nodiscard]] long max_syscall_size (double budget, double delay) const;
+
+        [[nodiscard]] long max_syscall_size_complete (double budget, double delay, int fd, long offset) const;
+
+        [[nodiscard]] long max_library_size (double budget, double delay) const;
+
+        /**
+         * Array forms of sync_io_cost and direct_io_cost, vectorized with std::experimental::simd where the
+         * standard library provides it. Sizes are expected below 2^53 bytes.
+         *
+         * @param sizes     sizes of the writes
+         * @param is_rnd    whether the i-th write needs a seek
+         * @param costs     receives the cost of every write, must hold sizes.size () entries
+         */
+        void sync_io_cost (std::span <const long> sizes, std::span <const bool> is_rnd,
+                           std::span <double> costs) const noexcept;
+
+        void direct_io_cost (std::span <const long> sizes, std::span <const bool> is_rnd,
+                             std::span <double> costs) const noexcept;
+
     };
+
+    // the policies the model is built for, the definitions are in io_cost.cpp
+    extern template class basic_io_cost <default_throttle>;
+    extern template class basic_io_cost <blended_throttle>;
+    extern template class basic_io_cost <capped_throttle>;
+    extern template class basic_io_cost <strictlimit_throttle>;
+
+    using io_cost = basic_io_cost <default_throttle>;
 }
 
 #endif //EVALUATION_IO_COST_HPP
@@ -0,0 +1,109 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_MONTE_CARLO_HPP
+#define EVALUATION_MONTE_CARLO_HPP
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+#include "io_cost.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace model {
+
+    // costs of all replicas of a Monte Carlo run, sorted for percentile queries
+    class cost_distribution {
+    private:
+        std::vector <double> writes {};
+        std::vector <double> totals {};
+
+        static inline double percentile (const std::vector <double> &sorted, double p) noexcept {
+            if (sorted.empty ()) {
+                return 0.0;
+            }
+            const double rank = std::clamp (p, 0.0, 100.0) / 100.0 * static_cast <double> (sorted.size () - 1);
+            const auto lower = static_cast <std::size_t> (rank);
+            const auto upper = std::min (lower + 1, sorted.size () - 1);
+            return sorted [lower] + (rank - static_cast <double> (lower)) * (sorted [upper] - sorted [lower]);
+        }
+
+    public:
+
+        cost_distribution (std::vector <double> write_costs, std::vector <double> total_costs) :
+        writes {std::move (write_costs)}, totals {std::move (total_costs)} {
+            std::sort (writes.begin (), writes.end ());
+            std::sort (totals.begin (), totals.end ());
+        }
+
+        // the p-th percentile of the cost of single writes over all replicas, p in [0, 100]
+        [[nodiscard]] inline double write_percentile (double p) const noexcept {
+            return percentile (writes, p);
+        }
+
+        // the p-th percentile of the total cost of the trace, p in [0, 100]
+        [[nodiscard]] inline double total_percentile (double p) const noexcept {
+            return percentile (totals, p);
+        }
+
+        [[nodiscard]] inline std::size_t replicas () const noexcept {
+            return totals.size ();
+        }
+    };
+
+    // default evaluation of a replica: the trace as buffered write syscalls of the fast model
+    struct trace_syscall_writes {
+        inline trace_statistics operator () (io_cost &iocost, const write_trace &trace, std::span <double> costs) const {
+            return iocost.syscall_io_cost (trace, costs);
+        }
+    };
+
+    /**
+     * Evaluates a trace on replicas of the model, each on a host variant drawn with system_env::sample. Replica
+     * r draws from an engine seeded with seed and r only, so the result does not depend on which worker runs
+     * which replica and replicas share no state.
+     *
+     * @param evaluate  called as evaluate (io_cost &, const write_trace &, std::span <double> costs), fills the
+     *                  cost of every write into costs and returns the trace's statistics
+     */
+    template <typename Evaluate = trace_syscall_writes>
+    cost_distribution monte_carlo (const measurement::system_env &env, const write_trace &trace, std::size_t replicas,
+                                   std::uint64_t seed, Evaluate evaluate = {},
+                                   work_stealing_pool pool = work_stealing_pool {}) {
+
+        const auto n = trace.length ();
+        std::vector <double> writes (replicas * n);
+        std::vector <double> totals (replicas);
+
+        pool.run (replicas, [&] (std::size_t replica, unsigned) {
+            // seed_seq keeps only the low 32 bits of every value
+            const auto replica_bits = static_cast <std::uint64_t> (replica);
+            std::seed_seq seq {static_cast <std::uint32_t> (seed), static_cast <std::uint32_t> (seed >> 32),
+                               static_cast <std::uint32_t> (replica_bits), static_cast <std::uint32_t> (replica_bits >> 32)};
+            std::mt19937_64 engine (seq);
+            const auto variant = env.sample (engine);
+            io_cost iocost (variant);
+            const std::span <double> costs {writes.data () + replica * n, n};
+            totals [replica] = evaluate (iocost, trace, costs).total;
+        });
+
+        return {std::move (writes), std::move (totals)};
+    }
+}
+
+#endif //EVALUATION_MONTE_CARLO_HPP
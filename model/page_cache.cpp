@@ -0,0 +1,322 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <algorithm>
+#include <cassert>
+#include "page_cache.hpp"
+
+
+void model::page_cache::lru_list::push_back (extent *ext) noexcept {
+    ext->prev = tail;
+    ext->next = nullptr;
+    if (tail) {
+        tail->next = ext;
+    }
+    else {
+        head = ext;
+    }
+    tail = ext;
+    length ++;
+}
+
+void model::page_cache::lru_list::insert_after (extent *pos, extent *ext) noexcept {
+    ext->prev = pos;
+    ext->next = pos->next;
+    if (pos->next) {
+        pos->next->prev = ext;
+    }
+    else {
+        tail = ext;
+    }
+    pos->next = ext;
+    length ++;
+}
+
+void model::page_cache::lru_list::remove (extent *ext) noexcept {
+    if (ext->prev) {
+        ext->prev->next = ext->next;
+    }
+    else {
+        head = ext->next;
+    }
+    if (ext->next) {
+        ext->next->prev = ext->prev;
+    }
+    else {
+        tail = ext->prev;
+    }
+    ext->prev = ext->next = nullptr;
+    length --;
+}
+
+model::page_cache::page_cache (const page_cache &other) : clean {other.clean} {
+    // the links of the copied extents would point into the other cache, so the lists are rebuilt in order
+    auto copy_list = [this, &other] (const lru_list &from, lru_list &to) {
+        for (const extent *ext = from.head; ext; ext = ext->next) {
+            auto &extents = files [ext->dblock.fd];
+            auto &copy = extents.emplace (ext->dblock.offset, extent {ext->dblock}).first->second;
+            to.push_back (&copy);
+            expiry_index.insert (&copy);
+        }
+    };
+    copy_list (other.inactive, inactive);
+    copy_list (other.active, active);
+}
+
+model::page_cache::extent &
+model::page_cache::insert (extent_map &extents, extent_map::const_iterator hint, const data_block &dblock) {
+    auto &ext = extents.emplace_hint (hint, dblock.offset, extent {dblock})->second;
+    expiry_index.insert (&ext);
+    if (dblock.active) {
+        active.push_back (&ext);
+    }
+    else {
+        inactive.push_back (&ext);
+    }
+    return ext;
+}
+
+void model::page_cache::erase (extent_map &extents, extent_map::iterator pos) {
+    auto *ext = &pos->second;
+    expiry_index.erase (ext);
+    if (ext->dblock.active) {
+        active.remove (ext);
+    }
+    else {
+        inactive.remove (ext);
+    }
+    extents.erase (pos);
+}
+
+long model::page_cache::place (const data_block &dblock) {
+
+    auto &extents = files [dblock.fd];
+    const long start = dblock.offset;
+    const long end = dblock.offset + dblock.size;
+    clean.erase (dblock.fd, start, dblock.size);
+
+    // first extent that ends after the start of the new block
+    auto pos = extents.lower_bound (start);
+    if (pos != extents.begin ()) {
+        auto prev = std::prev (pos);
+        if (prev->second.dblock.offset + prev->second.dblock.size > start) {
+            pos = prev;
+        }
+    }
+
+    std::vector <data_block> insert_to_cache;
+    auto add_fragment = [&insert_to_cache] (const data_block &fragment) {
+        if (fragment.size <= 0) {
+            return;
+        }
+        if (!insert_to_cache.empty ()) {
+            auto &last = insert_to_cache.back ();
+            if (last.offset + last.size == fragment.offset && last.io_finish_time == fragment.io_finish_time &&
+                last.active == fragment.active) {
+                last.size += fragment.size;
+                return;
+            }
+        }
+        insert_to_cache.push_back (fragment);
+    };
+
+    long dirty_change {};
+    auto offset = start;
+
+    while (pos != extents.end () && pos->first < end) {
+
+        auto &covered = pos->second.dblock;
+        const auto covered_begin = covered.offset;
+        const auto covered_end = covered.offset + covered.size;
+
+        if (offset < covered_begin) {
+            add_fragment ({dblock.fd, offset, covered_begin - offset, dblock.io_finish_time, false});
+        }
+
+        // overwritten data is referenced again
+        const auto overlap_begin = std::max (start, covered_begin);
+        const auto overlap_end = std::min (end, covered_end);
+        add_fragment ({dblock.fd, overlap_begin, overlap_end - overlap_begin, dblock.io_finish_time, true});
+        offset = overlap_end;
+        dirty_change -= overlap_end - overlap_begin;
+
+        // the remainders of the covered block keep their place in the lists
+        if (covered_begin < start && end < covered_end) {
+            auto tail = covered;
+            tail.offset = end;
+            tail.size = covered_end - end;
+            covered.size = start - covered_begin;
+            auto &lru = covered.active ? active : inactive;
+            auto &ext = extents.emplace_hint (std::next (pos), tail.offset, extent {tail})->second;
+            lru.insert_after (&pos->second, &ext);
+            expiry_index.insert (&ext);
+            break;
+        }
+        else if (covered_begin < start) {
+            covered.size = start - covered_begin;
+            ++ pos;
+        }
+        else if (end < covered_end) {
+            auto node = extents.extract (pos ++);
+            node.key () = end;
+            node.mapped ().dblock.offset = end;
+            node.mapped ().dblock.size = covered_end - end;
+            pos = extents.insert (pos, std::move (node));
+            break;
+        }
+        else {
+            auto covered_pos = pos ++;
+            erase (extents, covered_pos);
+        }
+    }
+
+    if (offset < end) {
+        add_fragment ({dblock.fd, offset, end - offset, dblock.io_finish_time, false});
+    }
+
+    for (const auto &fragment: insert_to_cache) {
+        insert (extents, pos, fragment);
+        dirty_change += fragment.size;
+    }
+
+    return dirty_change;
+}
+
+void model::page_cache::balance () noexcept {
+
+    const auto make_inactive = active.length - size () / 2;
+    for (long i = 0; i < make_inactive; ++i) {
+        auto *ext = active.head;
+        active.remove (ext);
+        ext->dblock.active = false;
+        inactive.push_back (ext);
+    }
+}
+
+const model::page_cache::data_block *model::page_cache::next_writeback (int fd, long offset) const noexcept {
+    auto file = files.find (fd);
+    if (file == files.end () || file->second.empty ()) {
+        return nullptr;
+    }
+    const auto &extents = file->second;
+    auto pos = extents.lower_bound (offset);
+    if (pos != extents.begin ()) {
+        auto prev = std::prev (pos);
+        if (prev->second.dblock.offset + prev->second.dblock.size > offset) {
+            pos = prev;
+        }
+    }
+    return pos == extents.end () ? &extents.begin ()->second.dblock : &pos->second.dblock;
+}
+
+int model::page_cache::next_file (int fd) const noexcept {
+    auto file = files.find (fd);
+    if (file == files.end ()) {
+        return files.empty () ? fd : files.begin ()->first;
+    }
+    ++ file;
+    return file == files.end () ? files.begin ()->first : file->first;
+}
+
+long model::page_cache::writeback (const data_block &dblock, long size) {
+
+    // dblock refers into the cache and does not survive the erase
+    const auto fd = dblock.fd;
+    auto &extents = files.at (fd);
+    auto pos = extents.find (dblock.offset);
+    assert (pos != extents.end ());
+
+    clean.insert (fd, dblock.offset, std::min (size, dblock.size));
+
+    if (size >= pos->second.dblock.size) {
+        const long cleaned = pos->second.dblock.size;
+        erase (extents, pos);
+        if (extents.empty ()) {
+            files.erase (fd);
+        }
+        return cleaned;
+    }
+
+    // the written back head of the block is clean, the rest stays dirty. The node and therefore its list
+    // links and index entries survive the re-keying
+    auto node = extents.extract (pos);
+    node.key () += size;
+    node.mapped ().dblock.offset += size;
+    node.mapped ().dblock.size -= size;
+    extents.insert (std::move (node));
+    return size;
+}
+
+std::pair <long, long> model::page_cache::writeback_file (int fd) {
+    auto file = files.find (fd);
+    if (file == files.end ()) {
+        return {0, 0};
+    }
+    auto &extents = file->second;
+    long cleaned {};
+    long runs {};
+    long end {-1};
+    while (!extents.empty ()) {
+        const auto pos = extents.begin ();
+        const auto &dblock = pos->second.dblock;
+        clean.insert (fd, dblock.offset, dblock.size);
+        cleaned += dblock.size;
+        runs += dblock.offset != end;
+        end = dblock.offset + dblock.size;
+        erase (extents, pos);
+    }
+    files.erase (file);
+    return {cleaned, runs};
+}
+
+template <typename Fn>
+void model::page_cache::for_each_overlap (int fd, long offset, long size, Fn fn) const {
+    auto file = files.find (fd);
+    if (file == files.end ()) {
+        return;
+    }
+    const auto &extents = file->second;
+    auto pos = extents.lower_bound (offset);
+    if (pos != extents.begin ()) {
+        auto prev = std::prev (pos);
+        if (prev->second.dblock.offset + prev->second.dblock.size > offset) {
+            pos = prev;
+        }
+    }
+    for (; pos != extents.end () && pos->first < offset + size; ++pos) {
+        fn (pos->second.dblock);
+    }
+}
+
+long model::page_cache::dirty_bytes (int fd, long offset, long size) const {
+    long bytes {};
+    for_each_overlap (fd, offset, size, [&bytes, offset, size] (const data_block &dblock) {
+        bytes += std::min (offset + size, dblock.offset + dblock.size) - std::max (offset, dblock.offset);
+    });
+    return bytes;
+}
+
+long model::page_cache::resident (int fd, long offset, long size) {
+    return dirty_bytes (fd, offset, size) + clean.touch (fd, offset, size);
+}
+
+void model::page_cache::make_resident (int fd, long offset, long size) {
+    long begin = offset;
+    for_each_overlap (fd, offset, size, [this, fd, &begin] (const data_block &dblock) {
+        clean.insert (fd, begin, dblock.offset - begin);
+        begin = dblock.offset + dblock.size;
+    });
+    clean.insert (fd, begin, offset + size - begin);
+}
@@ -0,0 +1,178 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_PAGE_CACHE_HPP
+#define EVALUATION_PAGE_CACHE_HPP
+
+#include <map>
+#include <set>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "resident_set.hpp"
+
+namespace model {
+
+    // dirty data of the complete model, kept as non-overlapping extents per file, and the clean resident data
+    class page_cache {
+    public:
+        struct data_block {
+            int fd;
+            long offset;
+            long size;
+            double io_finish_time;
+            bool active;
+        };
+
+    private:
+        // a cached block together with its links in the active or inactive list
+        struct extent {
+            data_block dblock;
+            extent *prev {};
+            extent *next {};
+        };
+
+        // intrusive list of extents, the head holds the least recently used one
+        struct lru_list {
+            extent *head {};
+            extent *tail {};
+            long length {};
+
+            void push_back (extent *ext) noexcept;
+            void insert_after (extent *pos, extent *ext) noexcept;
+            void remove (extent *ext) noexcept;
+        };
+
+        // offset -> extent, extents of one file never overlap
+        using extent_map = std::map <long, extent>;
+
+        // orders extents by the time they were dirtied, extents are referenced by their stable node address
+        struct expiry_order {
+            inline bool operator () (const extent *a, const extent *b) const noexcept {
+                if (a->dblock.io_finish_time != b->dblock.io_finish_time) {
+                    return a->dblock.io_finish_time < b->dblock.io_finish_time;
+                }
+                return std::less <const extent *> {} (a, b);
+            }
+        };
+
+        std::unordered_map <int, extent_map> files {};
+        std::set <const extent *, expiry_order> expiry_index {};
+        lru_list active {};
+        lru_list inactive {};
+        resident_set clean {};
+
+        // calls fn (dblock) for every dirty block overlapping the range, in offset order
+        template <typename Fn>
+        void for_each_overlap (int fd, long offset, long size, Fn fn) const;
+
+        extent &insert (extent_map &extents, extent_map::const_iterator hint, const data_block &dblock);
+        void erase (extent_map &extents, extent_map::iterator pos);
+
+    public:
+
+        page_cache () = default;
+
+        page_cache (const page_cache &other);
+
+        page_cache &operator= (const page_cache &) = delete;
+
+        [[nodiscard]] inline bool empty () const noexcept {
+            return expiry_index.empty ();
+        }
+
+        [[nodiscard]] inline long size () const noexcept {
+            return static_cast <long> (expiry_index.size ());
+        }
+
+        [[nodiscard]] inline long active_pages () const noexcept {
+            return active.length;
+        }
+
+        // dirtying time of the oldest block, the cache must not be empty
+        [[nodiscard]] inline double oldest () const noexcept {
+            return (*expiry_index.begin ())->dblock.io_finish_time;
+        }
+
+        [[nodiscard]] inline bool expired (double before) const noexcept {
+            return !expiry_index.empty () && oldest () <= before;
+        }
+
+        /**
+         * Places a newly written block in the cache. Overlapped parts of older blocks are replaced by the new
+         * data and marked active, the remainders of the older blocks are kept as they are.
+         *
+         * @param dblock    the written block
+         * @return          the change of the dirty data in bytes
+         */
+        long place (const data_block &dblock);
+
+        /**
+         * Demotes the least recently activated blocks to the inactive list until at most half of the blocks
+         * are active.
+         */
+        void balance () noexcept;
+
+        [[nodiscard]] inline const data_block &next_writeback () const noexcept {
+            return inactive.head->dblock;
+        }
+
+        /**
+         * The first dirty block of a file at or after an offset, wrapping around to the beginning of the file.
+         *
+         * @return      nullptr if the file has no dirty data
+         */
+        [[nodiscard]] const data_block *next_writeback (int fd, long offset) const noexcept;
+
+        // another file with dirty data than fd, in a fixed round-robin order, or fd if there is no other one
+        [[nodiscard]] int next_file (int fd) const noexcept;
+
+        /**
+         * Writes back the first bytes of a block.
+         *
+         * @param dblock    the block to write back, as returned by next_writeback
+         * @param size      number of bytes to write back from the beginning of the block
+         * @return          number of cleaned bytes
+         */
+        long writeback (const data_block &dblock, long size);
+
+        /**
+         * Writes back all dirty blocks of a file, e.g. on fsync. The data stays resident as clean data.
+         *
+         * @return          number of cleaned bytes and number of contiguous runs they were written in
+         */
+        std::pair <long, long> writeback_file (int fd);
+
+        // bounds the clean resident data, dirty data is never evicted
+        inline void set_capacity (long max_bytes) {
+            clean.set_capacity (max_bytes);
+        }
+
+        // number of dirty bytes of a range
+        [[nodiscard]] long dirty_bytes (int fd, long offset, long size) const;
+
+        /**
+         * Number of bytes of a range that are in the cache, either dirty or clean. The clean parts count as
+         * referenced.
+         */
+        long resident (int fd, long offset, long size);
+
+        // makes the parts of a range that are not dirty clean and resident, e.g. after reading them
+        void make_resident (int fd, long offset, long size);
+
+    };
+}
+
+#endif //EVALUATION_PAGE_CACHE_HPP
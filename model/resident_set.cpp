@@ -0,0 +1,131 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <algorithm>
+#include "resident_set.hpp"
+
+
+void model::resident_set::add (extent_map &extents, int fd, long offset, long size, long extent_seq) {
+    if (size <= 0) {
+        return;
+    }
+    extents.emplace (offset, clean_extent {size, extent_seq});
+    lru.emplace (extent_seq, fd, offset);
+    bytes += size;
+}
+
+void model::resident_set::set_capacity (long max_bytes) {
+    capacity = max_bytes;
+    evict ();
+}
+
+void model::resident_set::erase (int fd, long offset, long size) {
+    auto file = files.find (fd);
+    if (file == files.end ()) {
+        return;
+    }
+    auto &extents = file->second;
+    const long end = offset + size;
+
+    auto pos = extents.lower_bound (offset);
+    if (pos != extents.begin ()) {
+        auto prev = std::prev (pos);
+        if (prev->first + prev->second.size > offset) {
+            pos = prev;
+        }
+    }
+
+    while (pos != extents.end () && pos->first < end) {
+        const long begin = pos->first;
+        const auto [extent_size, extent_seq] = pos->second;
+        auto next = std::next (pos);
+        lru.erase ({extent_seq, fd, begin});
+        bytes -= extent_size;
+        extents.erase (pos);
+        // the parts outside of the range stay resident with their age
+        add (extents, fd, begin, offset - begin, extent_seq);
+        add (extents, fd, end, begin + extent_size - end, extent_seq);
+        pos = next;
+    }
+
+    if (extents.empty ()) {
+        files.erase (file);
+    }
+}
+
+void model::resident_set::insert (int fd, long offset, long size) {
+    if (size <= 0) {
+        return;
+    }
+    erase (fd, offset, size);
+    add (files [fd], fd, offset, size, seq ++);
+    evict ();
+}
+
+long model::resident_set::touch (int fd, long offset, long size) {
+    auto file = files.find (fd);
+    if (file == files.end ()) {
+        return 0;
+    }
+    auto &extents = file->second;
+    const long end = offset + size;
+
+    auto pos = extents.lower_bound (offset);
+    if (pos != extents.begin ()) {
+        auto prev = std::prev (pos);
+        if (prev->first + prev->second.size > offset) {
+            pos = prev;
+        }
+    }
+
+    long resident {};
+    for (; pos != extents.end () && pos->first < end; ++pos) {
+        const long begin = std::max (offset, pos->first);
+        const long finish = std::min (end, pos->first + pos->second.size);
+        resident += finish - begin;
+
+        // referenced data becomes the most recently used
+        lru.erase ({pos->second.seq, fd, pos->first});
+        pos->second.seq = seq ++;
+        lru.emplace (pos->second.seq, fd, pos->first);
+    }
+    return resident;
+}
+
+void model::resident_set::evict () {
+    while (bytes > capacity && !lru.empty ()) {
+        const auto [extent_seq, fd, offset] = *lru.begin ();
+        auto &extents = files.at (fd);
+        auto pos = extents.find (offset);
+        const long excess = bytes - capacity;
+
+        if (pos->second.size <= excess) {
+            lru.erase (lru.begin ());
+            bytes -= pos->second.size;
+            extents.erase (pos);
+            if (extents.empty ()) {
+                files.erase (fd);
+            }
+        }
+        else {
+            // evict the head of the extent only
+            const auto rest = pos->second.size - excess;
+            lru.erase (lru.begin ());
+            bytes -= pos->second.size;
+            extents.erase (pos);
+            add (extents, fd, offset + excess, rest, extent_seq);
+        }
+    }
+}
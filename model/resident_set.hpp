@@ -0,0 +1,70 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_RESIDENT_SET_HPP
+#define EVALUATION_RESIDENT_SET_HPP
+
+#include <map>
+#include <set>
+#include <tuple>
+#include <limits>
+#include <unordered_map>
+
+namespace model {
+
+    // clean data kept in the page cache, the least recently used data is evicted beyond the capacity
+    class resident_set {
+    private:
+        struct clean_extent {
+            long size;
+            long seq;
+        };
+
+        using extent_map = std::map <long, clean_extent>;
+
+        std::unordered_map <int, extent_map> files {};
+        // seq, fd, offset of every extent, the least recently used one first
+        std::set <std::tuple <long, int, long>> lru {};
+        long capacity {std::numeric_limits <long>::max ()};
+        long bytes {};
+        long seq {};
+
+        void add (extent_map &extents, int fd, long offset, long size, long extent_seq);
+        void evict ();
+
+    public:
+
+        [[nodiscard]] inline long size () const noexcept {
+            return bytes;
+        }
+
+        void set_capacity (long max_bytes);
+
+        /**
+         * Marks a range as clean and resident. Parts of it that are resident already are refreshed.
+         */
+        void insert (int fd, long offset, long size);
+
+        // removes a range, e.g. because it is dirtied again
+        void erase (int fd, long offset, long size);
+
+        /**
+         * Number of resident bytes of a range, the resident parts count as used.
+         */
+        long touch (int fd, long offset, long size);
+    };
+}
+
+#endif //EVALUATION_RESIDENT_SET_HPP
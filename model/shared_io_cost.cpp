@@ -0,0 +1,134 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#include <cassert>
+#include <algorithm>
+#include "shared_io_cost.hpp"
+
+
+template <typename Throttle>
+std::vector <model::writer_result>
+model::basic_shared_io_cost <Throttle>::run (std::span <const write_trace> traces, std::span <const std::span <double>> costs) {
+    assert (traces.size () == costs.size ());
+
+    writers.clear ();
+    writers.reserve (traces.size ());
+    writing = 0;
+    for (std::size_t id = 0; id < traces.size (); ++id) {
+        assert (traces [id].delays.size () == traces [id].length () && costs [id].size () >= traces [id].length ());
+        writers.push_back ({traces [id], costs [id]});
+        writers.back ().result.finish_time = node.time;
+        if (traces [id].length () > 0) {
+            node.events.schedule (node.time + traces [id].delays [0], event_type::write_start, static_cast <long> (id));
+        }
+    }
+
+    // the writes are handled here, the flusher, its wakeups and the limit changes by the node
+    long active_writers = std::ranges::count_if (traces, [] (const auto &trace) {return trace.length () > 0;});
+    while (active_writers > 0) {
+        const auto ev = node.events.pop ();
+        node.background_flush (ev.time);
+        switch (ev.type) {
+            case event_type::write_start: {
+                auto &w = writers [ev.tag];
+                w.remaining = w.trace.sizes [w.next];
+                w.cost = 0.0;
+                writing ++;
+                dirty_chunk (ev.tag);
+                break;
+            }
+            case event_type::write_completion:
+                complete_chunk (ev.tag);
+                if (writers [ev.tag].next == writers [ev.tag].trace.length ()) {
+                    active_writers --;
+                }
+                break;
+            default:
+                node.handle (ev);
+                break;
+        }
+    }
+
+    std::vector <writer_result> results;
+    results.reserve (writers.size ());
+    for (auto &w: writers) {
+        const auto n = w.trace.length ();
+        w.result.stats.mean = n > 0 ? w.result.stats.total / static_cast <double> (n) : 0.0;
+        results.push_back (w.result);
+    }
+    return results;
+}
+
+template <typename Throttle>
+double model::basic_shared_io_cost <Throttle>::taskrate (const writer &w) const noexcept {
+    auto state = node.throttling (node.sys.bw_ramdisk, node.exist_expired_pages ());
+    // a writer that has not completed a write yet starts from the background rate
+    if (w.bw.value () > 0.0) {
+        state.bw_avg = w.bw.value ();
+    }
+    // beyond the hard limit the writers wait for their share of the writeback
+    state.bw_sync /= static_cast <double> (std::max (writing, 1l));
+    return throttle_of <Throttle>::fast::taskrate (state);
+}
+
+template <typename Throttle>
+void model::basic_shared_io_cost <Throttle>::dirty_chunk (long id) {
+    auto &w = writers [id];
+    const long chunk = writers.size () == 1 ? w.remaining : std::min (w.remaining, throttle_chunk);
+    double chunk_time = static_cast <double> (chunk) / taskrate (w) + node.reclaim_penalty (chunk);
+
+    // the syscall overhead is spent before the first chunk is copied
+    if (w.remaining == w.trace.sizes [w.next]) {
+        chunk_time += node.sys.sc_w;
+    }
+
+    const double now = node.time;
+    node.dirty += chunk;
+    node.io_list.push_back ({chunk, now + chunk_time});
+    node.schedule_expiry (now + chunk_time);
+    if (!node.flushing && node.total_dirty () >= node.flush_limit ()) {
+        node.events.schedule (now, event_type::flusher_wakeup);
+    }
+
+    w.remaining -= chunk;
+    w.cost += chunk_time;
+    node.events.schedule (now + chunk_time, event_type::write_completion, id);
+}
+
+template <typename Throttle>
+void model::basic_shared_io_cost <Throttle>::complete_chunk (long id) {
+    auto &w = writers [id];
+    if (w.remaining > 0) {
+        dirty_chunk (id);
+        return;
+    }
+
+    writing --;
+    const long size = w.trace.sizes [w.next];
+    w.bw.add (size, w.cost, node.time);
+    w.costs [w.next] = w.cost;
+    w.result.stats.add (size, w.cost);
+    w.result.finish_time = node.time;
+
+    w.next ++;
+    if (w.next < w.trace.length ()) {
+        node.events.schedule (node.time + w.trace.delays [w.next], event_type::write_start, id);
+    }
+}
+
+template class model::basic_shared_io_cost <model::default_throttle>;
+template class model::basic_shared_io_cost <model::blended_throttle>;
+template class model::basic_shared_io_cost <model::capped_throttle>;
+template class model::basic_shared_io_cost <model::strictlimit_throttle>;
@@ -0,0 +1,104 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_SHARED_IO_COST_HPP
+#define EVALUATION_SHARED_IO_COST_HPP
+
+#include <vector>
+#include <span>
+#include "../measurement/system_env.hpp"
+#include "io_cost.hpp"
+#include "write_trace.hpp"
+#include "bandwidth_estimator.hpp"
+
+namespace model {
+
+    struct writer_result {
+        trace_statistics stats {};
+        double finish_time {};
+    };
+
+    /**
+     * Several writers on one node sharing the dirty pool. The dirty data, the limits, the flusher and the
+     * device are those of the fast model of one node, every writer has its own bandwidth estimate and is
+     * throttled by the fast policy of Throttle. Beyond the hard limit the writers with a write in flight share
+     * the writeback bandwidth. With several writers a write is dirtied in chunks of throttle_chunk bytes and the throttling
+     * regime is decided per chunk, so concurrent writers see each other's dirty data while their writes are in
+     * progress. A single writer dirties every write at once and costs what the fast model of io_cost does.
+     */
+    template <typename Throttle>
+    class basic_shared_io_cost {
+    private:
+        static constexpr long throttle_chunk = 1024l * 1024l;
+
+        struct writer {
+            write_trace trace;
+            std::span <double> costs;
+            std::size_t next {};
+            long remaining {};
+            double cost {};
+            bandwidth_estimator bw {};
+            writer_result result {};
+        };
+
+        basic_io_cost <Throttle> node;
+        std::vector <writer> writers {};
+        // writers with a write in flight, they share the writeback beyond the hard limit
+        long writing {};
+
+        [[nodiscard]] double taskrate (const writer &w) const noexcept;
+
+        void dirty_chunk (long id);
+
+        void complete_chunk (long id);
+
+    public:
+
+        explicit basic_shared_io_cost (const measurement::system_env &env) : node {env} {}
+
+        [[nodiscard]] inline long dirty () const noexcept {
+            return node.dirty;
+        }
+
+        // dirtying by other processes, see basic_io_cost::set_background_load
+        inline void set_background_load (dirty_rate_series series) {
+            node.set_background_load (std::move (series));
+        }
+
+        // a change of the dirtyable memory during the run, see basic_io_cost::schedule_dirtyable_memory
+        inline void schedule_dirtyable_memory (double at, long bytes) {
+            node.schedule_dirtyable_memory (at, bytes);
+        }
+
+        /**
+         * Replays the traces of all writers concurrently, starting at the current model time.
+         *
+         * @param traces    one trace per writer, only sizes and delays are used
+         * @param costs     one span per writer receiving the cost of each of its writes
+         * @return          the statistics and the finish time of every writer
+         */
+        std::vector <writer_result> run (std::span <const write_trace> traces, std::span <const std::span <double>> costs);
+    };
+
+    // the policies the model is built for, the definitions are in shared_io_cost.cpp
+    extern template class basic_shared_io_cost <default_throttle>;
+    extern template class basic_shared_io_cost <blended_throttle>;
+    extern template class basic_shared_io_cost <capped_throttle>;
+    extern template class basic_shared_io_cost <strictlimit_throttle>;
+
+    using shared_io_cost = basic_shared_io_cost <default_throttle>;
+}
+
+#endif //EVALUATION_SHARED_IO_COST_HPP
@@ -0,0 +1,93 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_SWEEP_HPP
+#define EVALUATION_SWEEP_HPP
+
+#include <ostream>
+#include <mutex>
+#include <vector>
+
+#include "io_cost.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace model {
+
+    struct sweep_point {
+        std::size_t env;
+        long chunk_size;
+        double interval;
+        long writes;
+    };
+
+    // cartesian product of host variants, chunk sizes and compute intervals
+    struct sweep_grid {
+        std::vector <measurement::system_env> envs {};
+        std::vector <long> chunk_sizes {};
+        std::vector <double> intervals {};
+        long writes {1};
+
+        [[nodiscard]] inline std::size_t size () const noexcept {
+            return envs.size () * chunk_sizes.size () * intervals.size ();
+        }
+
+        [[nodiscard]] inline sweep_point at (std::size_t i) const noexcept {
+            const auto interval = i % intervals.size ();
+            i /= intervals.size ();
+            const auto chunk_size = i % chunk_sizes.size ();
+            i /= chunk_sizes.size ();
+            return {i, chunk_sizes [chunk_size], intervals [interval], writes};
+        }
+    };
+
+    // default evaluation of a grid point: buffered writes of chunk_size, each after interval seconds of compute
+    struct periodic_syscall_writes {
+        inline trace_statistics operator () (io_cost &iocost, const sweep_point &point) const {
+            trace_statistics stats;
+            for (long i = 0; i < point.writes; ++i) {
+                stats.add (point.chunk_size, iocost.syscall_io_cost (point.chunk_size, point.interval));
+            }
+            stats.mean = point.writes > 0 ? stats.total / static_cast <double> (point.writes) : 0.0;
+            return stats;
+        }
+    };
+
+    /**
+     * Evaluates every grid point on a fresh io_cost instance and streams one line per point to out as soon as
+     * it is done: env, chunk size, interval, total, mean, min and max cost. Lines are not in grid order.
+     *
+     * @param evaluate  called as evaluate (io_cost &, const sweep_point &) and returns the point's statistics
+     */
+    template <typename Evaluate = periodic_syscall_writes>
+    void sweep (const sweep_grid &grid, std::ostream &out, Evaluate evaluate = {},
+                work_stealing_pool pool = work_stealing_pool {}) {
+
+        std::mutex out_mtx;
+
+        pool.run (grid.size (), [&grid, &out, &out_mtx, &evaluate] (std::size_t task, unsigned) {
+            const auto point = grid.at (task);
+            io_cost iocost (grid.envs [point.env]);
+            const auto stats = evaluate (iocost, point);
+
+            std::lock_guard <std::mutex> lk (out_mtx);
+            out << point.env << "\t" << point.chunk_size << "\t" << point.interval << "\t"
+                << stats.total << "\t" << stats.mean << "\t" << stats.min << "\t" << stats.max << "\n";
+        });
+
+        out.flush ();
+    }
+}
+
+#endif //EVALUATION_SWEEP_HPP
@@ -0,0 +1,158 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_THROTTLE_POLICY_HPP
+#define EVALUATION_THROTTLE_POLICY_HPP
+
+#include <algorithm>
+
+namespace model {
+
+    // what a throttling decision of a writer is based on
+    struct throttle_state {
+        long dirty;
+        long limit_bg;
+        long limit_hard;
+        bool expired;
+        // bandwidth of the writer's completed writes
+        double bw_avg;
+        // rate of the writer without throttling and the share of it left while the flusher runs
+        double freerun;
+        double coeff_bg;
+        // writers beyond the hard limit wait for the writeback and dirty data at its bandwidth
+        double bw_sync;
+        // max_ratio of the backing device in percent, the largest share of the limits it may use
+        int max_ratio;
+    };
+
+    // the cubic position ratio of the dirty data around the setpoint, 1 at the setpoint and 0 at the limit
+    inline constexpr double pos_ratio (long dirty, long setpoint, long limit) noexcept {
+        const double val = static_cast <double> (setpoint - dirty) / static_cast <double> (limit - setpoint);
+        return 1.0 + val * val * val;
+    }
+
+    /**
+     * Throttling policies decide the rate a writer dirties data at. Writers run free below the background
+     * limit, at the background rate while the flusher runs and are throttled towards the writeback bandwidth
+     * beyond the setpoint half way between the background and the hard limit. Beyond the hard limit, e.g.
+     * after the limits were lowered, they only proceed as fast as the data is written back. A policy also
+     * names the dirty data beyond which the flusher writes back in the background.
+     */
+
+    // the throttled rate is blended with the background rate of the writer, as in the fast model so far
+    struct blended_throttle {
+        static constexpr long background_limit (long limit_bg, int) noexcept {
+            return limit_bg;
+        }
+
+        static constexpr double taskrate (const throttle_state &s) noexcept {
+            const long setpoint = (s.limit_bg + s.limit_hard) / 2;
+            const double bg_rate = s.freerun * s.coeff_bg;
+            if (s.dirty >= s.limit_hard) {
+                return s.bw_sync;
+            }
+            if (s.dirty >= setpoint) {
+                const double rate = s.bw_avg * pos_ratio (s.dirty, setpoint, s.limit_hard);
+                return rate * bg_rate / (bg_rate + rate * (1 - s.coeff_bg));
+            }
+            if (s.dirty >= s.limit_bg || s.expired) {
+                return bg_rate;
+            }
+            return s.freerun;
+        }
+    };
+
+    // the throttled rate never exceeds the background rate, as in the complete model so far
+    struct capped_throttle {
+        static constexpr long background_limit (long limit_bg, int) noexcept {
+            return limit_bg;
+        }
+
+        static constexpr double taskrate (const throttle_state &s) noexcept {
+            const long setpoint = (s.limit_bg + s.limit_hard) / 2;
+            const double bg_rate = s.freerun * s.coeff_bg;
+            if (s.dirty >= s.limit_hard) {
+                return s.bw_sync;
+            }
+            if (s.dirty >= setpoint) {
+                return std::min (s.bw_avg * pos_ratio (s.dirty, setpoint, s.limit_hard), bg_rate);
+            }
+            if (s.dirty >= s.limit_bg || s.expired) {
+                return bg_rate;
+            }
+            return s.freerun;
+        }
+    };
+
+    /**
+     * Throttling of a device with BDI_CAP_STRICTLIMIT, e.g. FUSE. The device is held to its own share of the
+     * dirty limits even while the global dirty data is below them. The kernel gives a device the part of the
+     * limits its share of the recent writeout earns plus its min_ratio, capped at its max_ratio. The modelled
+     * device does all the writeback, so it earns the whole pool and min_ratio has no effect; only max_ratio
+     * bounds its share. The flusher starts once the device exceeds its share of the background limit. Like the
+     * kernel, the position ratio of the device does not drop below a quarter.
+     */
+    struct strictlimit_throttle {
+
+        static constexpr long share (long limit, int max_ratio) noexcept {
+            return limit / 100 * std::clamp (max_ratio, 0, 100);
+        }
+
+        // the device is also written back once it exceeds its share of the background limit
+        static constexpr long background_limit (long limit_bg, int max_ratio) noexcept {
+            return share (limit_bg, max_ratio);
+        }
+
+        static constexpr double taskrate (const throttle_state &s) noexcept {
+            const long limit_bg = share (s.limit_bg, s.max_ratio);
+            const long limit_hard = share (s.limit_hard, s.max_ratio);
+            const long setpoint = (limit_bg + limit_hard) / 2;
+            const double bg_rate = s.freerun * s.coeff_bg;
+            if (s.dirty >= limit_hard) {
+                return s.bw_sync;
+            }
+            if (s.dirty >= setpoint) {
+                const double ratio = std::max (pos_ratio (s.dirty, setpoint, limit_hard), 0.25);
+                return std::min (s.bw_avg * ratio, bg_rate);
+            }
+            if (s.dirty >= limit_bg || s.expired) {
+                return bg_rate;
+            }
+            return s.freerun;
+        }
+    };
+
+    // the fast model throttles by Fast, the complete model by Complete
+    template <typename Fast, typename Complete>
+    struct split_throttle {
+        using fast = Fast;
+        using complete = Complete;
+    };
+
+    // the formulas of the fast and the complete model from before the policy could be chosen
+    using default_throttle = split_throttle <blended_throttle, capped_throttle>;
+
+    // the policies of both models, a single policy applies to both of them
+    template <typename Throttle>
+    struct throttle_of {
+        using fast = Throttle;
+        using complete = Throttle;
+    };
+
+    template <typename Fast, typename Complete>
+    struct throttle_of <split_throttle <Fast, Complete>> : split_throttle <Fast, Complete> {};
+}
+
+#endif //EVALUATION_THROTTLE_POLICY_HPP
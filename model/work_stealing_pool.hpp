@@ -0,0 +1,106 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_WORK_STEALING_POOL_HPP
+#define EVALUATION_WORK_STEALING_POOL_HPP
+
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+namespace model {
+
+    // runs a fixed set of independent tasks, idle workers steal from the front of the other workers' queues
+    class work_stealing_pool {
+    private:
+        struct worker_queue {
+            std::mutex mtx;
+            std::deque <std::size_t> tasks;
+        };
+
+        const unsigned nthreads;
+
+        static std::optional <std::size_t> pop_back (worker_queue &queue) {
+            std::lock_guard <std::mutex> lk (queue.mtx);
+            if (queue.tasks.empty ()) {
+                return std::nullopt;
+            }
+            auto task = queue.tasks.back ();
+            queue.tasks.pop_back ();
+            return task;
+        }
+
+        static std::optional <std::size_t> steal (worker_queue &queue) {
+            std::lock_guard <std::mutex> lk (queue.mtx);
+            if (queue.tasks.empty ()) {
+                return std::nullopt;
+            }
+            auto task = queue.tasks.front ();
+            queue.tasks.pop_front ();
+            return task;
+        }
+
+    public:
+        explicit work_stealing_pool (unsigned threads = std::thread::hardware_concurrency ()):
+        nthreads {std::max (1u, threads)} {}
+
+        [[nodiscard]] inline unsigned size () const noexcept {
+            return nthreads;
+        }
+
+        /**
+         * Runs fn (task, worker) for every task in [0, ntasks) and returns when all of them are done.
+         */
+        template <typename Fn>
+        void run (std::size_t ntasks, Fn fn) {
+
+            const auto nworkers = static_cast <unsigned> (std::min <std::size_t> (nthreads, std::max <std::size_t> (ntasks, 1)));
+            std::vector <worker_queue> queues (nworkers);
+
+            // contiguous blocks keep neighbouring grid points on one worker until stealing starts
+            for (std::size_t task = 0; task < ntasks; ++task) {
+                queues.at (task * nworkers / std::max <std::size_t> (ntasks, 1)).tasks.push_back (task);
+            }
+
+            auto work = [&queues, &fn, nworkers] (unsigned worker) {
+                for (;;) {
+                    auto task = pop_back (queues [worker]);
+                    for (unsigned victim = 1; !task && victim < nworkers; ++victim) {
+                        task = steal (queues [(worker + victim) % nworkers]);
+                    }
+                    if (!task) {
+                        return;
+                    }
+                    fn (*task, worker);
+                }
+            };
+
+            std::vector <std::thread> workers;
+            workers.reserve (nworkers - 1);
+            for (unsigned worker = 1; worker < nworkers; ++worker) {
+                workers.emplace_back (work, worker);
+            }
+            work (0);
+            for (auto &thr: workers) {
+                thr.join ();
+            }
+        }
+    };
+}
+
+#endif //EVALUATION_WORK_STEALING_POOL_HPP
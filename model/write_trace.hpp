@@ -0,0 +1,55 @@
+// Copyright 2023 Zuse Institute Berlin
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+
+#ifndef EVALUATION_WRITE_TRACE_HPP
+#define EVALUATION_WRITE_TRACE_HPP
+
+#include <span>
+#include <limits>
+
+namespace model {
+
+    /**
+     * A trace of writes as structure of arrays, the i-th entry of every array describes the i-th write.
+     * fds and offsets are only read by the complete model and may be left empty otherwise.
+     */
+    struct write_trace {
+        std::span <const long> sizes {};
+        std::span <const double> delays {};
+        std::span <const int> fds {};
+        std::span <const long> offsets {};
+
+        [[nodiscard]] inline std::size_t length () const noexcept {
+            return sizes.size ();
+        }
+    };
+
+    struct trace_statistics {
+        double total {};
+        double min {std::numeric_limits <double>::max ()};
+        double max {};
+        double mean {};
+        long bytes {};
+
+        inline void add (long size, double cost) noexcept {
+            total += cost;
+            min = cost < min ? cost : min;
+            max = cost > max ? cost : max;
+            bytes += size;
+        }
+    };
+}
+
+#endif //EVALUATION_WRITE_TRACE_HPP